@@ -0,0 +1,346 @@
+#include "ai.h"
+#include "utils.h"
+#include "splashkit.h"
+
+using namespace std;
+
+/**
+ * @brief A state in the AI player's beam search.
+ *
+ * @field sim The simulation state.
+ * @field score The state's score; see ai_weights.
+ * @field root The index of the falling piece's placement (in the root placements list) that the state was reached through.
+ *
+ */
+struct ai_node {
+    sim_data sim;
+    double score;
+    int root;
+};
+
+/* create default AI player options */
+ai_options new_ai_options() {
+    ai_options result;
+
+    result.weights.height = -0.51;
+    result.weights.holes = -3.6;
+    result.weights.bumpiness = -0.18;
+    result.weights.wells = -0.3;
+    result.weights.row_transitions = -0.5;
+    result.weights.column_transitions = -1.0;
+    result.weights.score = 0.008;
+
+    result.beam_width = AI_BEAM_WIDTH;
+    result.depth = AI_DEPTH;
+    result.time_budget_ms = AI_TIME_BUDGET_MS;
+
+    return result;
+}
+
+/* pick a placement with beam search */
+ai_result ai_search(const sim_data &sim, const ai_options &options, thread_pool *pool, const placement_list *candidates) {
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double, milli>(options.time_budget_ms);
+    bool timed = options.time_budget_ms > 0;
+    int depth = MIN(MAX(options.depth, 1), NEXT_PIECES_CNT); // the pieces after these haven't been shown yet
+
+    ai_result result;
+    result.found = false; result.score = -HUGE_VAL; result.depth = 0; result.nodes = 0;
+
+    placement_list all;
+    if(!candidates) generate_placements(sim, all);
+    const placement_list &roots = (candidates) ? *candidates : all;
+    if(roots.count == 0) return result;
+
+    vector<ai_node> beam(1);
+    copy_sim(beam[0].sim, sim); beam[0].score = 0; beam[0].root = -1;
+
+    for(int ply = 0; ply < depth; ply++) {
+        /* expand every state in the beam by all of its placements */
+        vector<vector<ai_node>> children(beam.size());
+        atomic<bool> late(false);
+        atomic<uint64_t> nodes(0);
+        auto expand = [&](size_t begin, size_t end) {
+            placement_list list;
+            for(size_t i = begin; i < end; i++) {
+                if(timed && ply > 0 && chrono::steady_clock::now() > deadline) { // the first ply always finishes, so that there's something to go with
+                    late = true;
+                    return;
+                }
+
+                const ai_node &parent = beam[i];
+                const placement_list &placements = (ply == 0) ? roots : list;
+                if(ply > 0) generate_placements(parent.sim, list);
+
+                children[i].reserve(placements.count);
+                for(int j = 0; j < placements.count; j++) {
+                    children[i].emplace_back();
+                    ai_node &child = children[i].back();
+                    copy_sim(child.sim, parent.sim);
+                    apply_placement(child.sim, placements.placements[j]);
+                    if(child.sim.game_over) {
+                        children[i].pop_back();
+                        continue;
+                    }
+                    child.root = (ply == 0) ? j : parent.root;
+                }
+                nodes += placements.count;
+
+                /* evaluate the children all together */
+                const sim_data *boards[placement_limits<uint16_t>::capacity];
+                double scores[placement_limits<uint16_t>::capacity];
+                for(size_t j = 0; j < children[i].size(); j++) boards[j] = &children[i][j].sim;
+                evaluate_boards(boards, (int)children[i].size(), options.weights, scores);
+                for(size_t j = 0; j < children[i].size(); j++) children[i][j].score = scores[j] + options.weights.score * (children[i][j].sim.score - sim.score);
+            }
+        };
+        if(pool && beam.size() > 1) pool_parallel_for(*pool, beam.size(), 1, expand);
+        else expand(0, beam.size());
+
+        result.nodes += nodes;
+        if(late) break; // out of time - go with the last finished ply
+
+        /* gather the children, keeping states that have been reached by different placement orders only once */
+        vector<const ai_node *> next;
+        unordered_map<uint64_t, size_t> seen;
+        for(const vector<ai_node> &group : children) {
+            for(const ai_node &child : group) {
+                auto found = seen.find(zobrist_key(child.sim));
+                if(found == seen.end()) {
+                    seen.emplace(zobrist_key(child.sim), next.size());
+                    next.push_back(&child);
+                } else if(child.score > next[found->second]->score) next[found->second] = &child;
+            }
+        }
+        if(next.empty()) break; // every placement ends the game
+
+        /* keep the best states */
+        auto better = [](const ai_node *a, const ai_node *b) { return a->score > b->score; };
+        if((int)next.size() > options.beam_width) {
+            nth_element(next.begin(), next.begin() + options.beam_width, next.end(), better);
+            next.resize(options.beam_width);
+        }
+        beam.resize(next.size());
+        for(size_t i = 0; i < next.size(); i++) {
+            copy_sim(beam[i].sim, next[i]->sim);
+            beam[i].score = next[i]->score; beam[i].root = next[i]->root;
+        }
+
+        const ai_node &best = **min_element(next.begin(), next.end(), better);
+        result.found = true; result.target = roots.placements[best.root]; result.score = best.score;
+        result.depth = ply + 1;
+    }
+
+    if(!result.found) {
+        /* every placement ends the game, so any will do */
+        result.found = true;
+        result.target = roots.placements[0];
+    }
+
+    return result;
+}
+
+/* find the moves to a placement */
+int find_path(const sim_data &sim, const placement &target, piece *path) {
+    /* positions are indexed by rotation, then Y and X coordinates (offset by how far they can go past the ceiling and the left wall) */
+    const int width = field_traits<uint16_t>::max_width + 4, height = FIELD_MAX_HEIGHT_16 + MOVEGEN_ROWS_ABOVE;
+    static_assert(4 * width * height <= AI_PATH_MAX, "AI_PATH_MAX must cover every position");
+    auto index = [width, height](const piece &p) { return (p.rotation * height + p.position.y + MOVEGEN_ROWS_ABOVE) * width + p.position.x + 4; };
+    auto in_range = [width, height](const piece &p) { return p.position.x + 4 >= 0 && p.position.x + 4 < width && p.position.y + MOVEGEN_ROWS_ABOVE >= 0 && p.position.y + MOVEGEN_ROWS_ABOVE < height; };
+
+    /* Dijkstra's search, where each move costs the same, except that rotations and left/right moves also cost a little more the further down they are,
+       so that out of the shortest paths, the one that makes them as early as possible is picked (as pieces that are resting on something can be locked by gravity at any time) */
+    const uint64_t move_cost = (uint64_t)1 << 32;
+    int16_t parents[AI_PATH_MAX]; // the position each position has been reached from, or -1 if not yet reached
+    uint64_t costs[AI_PATH_MAX];
+    memset(parents, -1, sizeof(parents));
+
+    piece start = sim.next_pieces[0], goal = placement_piece(sim, target);
+    if(!in_range(start) || !in_range(goal)) return 0;
+
+    typedef pair<uint64_t, piece> path_step;
+    auto later = [](const path_step &a, const path_step &b) { return a.first > b.first; };
+    priority_queue<path_step, vector<path_step>, decltype(later)> queue(later);
+    queue.push(path_step(0, start)); parents[index(start)] = (int16_t)index(start); costs[index(start)] = 0;
+    auto visit = [&](const piece &from, const piece &to, bool sideways) {
+        if(!in_range(to)) return;
+        uint64_t cost = costs[index(from)] + move_cost + ((sideways) ? (uint64_t)(from.position.y + MOVEGEN_ROWS_ABOVE) : 0);
+        if(parents[index(to)] >= 0 && costs[index(to)] <= cost) return;
+        parents[index(to)] = (int16_t)index(from); costs[index(to)] = cost;
+        queue.push(path_step(cost, to));
+    };
+
+    bool found = false;
+    while(!queue.empty()) {
+        path_step step = queue.top(); queue.pop();
+        piece p = step.second, test;
+        if(step.first > costs[index(p)]) continue; // already reached at a lower cost
+        if(p.rotation == goal.rotation && p.position.x == goal.position.x && p.position.y == goal.position.y) {
+            found = true;
+            break;
+        }
+
+        /* the same moves as handle_rotate(), handle_left_move(), handle_right_move() and handle_down_move() */
+        test = p; test.rotation = (test.rotation + 1) % 4;
+        for(int kick : {0, 1, -2}) {
+            test.position.x += kick;
+            if(!(check_collision(sim, test) & ~COLLISION_CEILING)) {
+                visit(p, test, true);
+                break;
+            }
+        }
+        test = p; test.position.x--;
+        if(!(check_collision(sim, test) & COLLISION_LEFT)) visit(p, test, true);
+        test = p; test.position.x++;
+        if(!(check_collision(sim, test) & COLLISION_RIGHT)) visit(p, test, true);
+        test = p; test.position.y++;
+        if(!(check_collision(sim, test) & COLLISION_BOTTOM)) visit(p, test, false);
+    }
+    if(!found) return 0;
+
+    /* walk back from the goal, then put the path in order */
+    int count = 0;
+    for(int i = index(goal); ; i = parents[i]) {
+        path[count].type = start.type;
+        path[count].rotation = (uint8_t)(i / (width * height));
+        path[count].position.y = (i / width) % height - MOVEGEN_ROWS_ABOVE;
+        path[count].position.x = i % width - 4;
+        count++;
+        if(parents[i] == i) break;
+    }
+    reverse(path, path + count);
+
+    return count;
+}
+
+/* create an AI player controller */
+ai_player new_ai_player(thread_pool *pool) {
+    ai_player result;
+
+    result.options = new_ai_options();
+    result.pool = pool;
+    result.enabled = false; result.planned = false;
+    result.path_len = 0; result.path_pos = 0;
+
+    return result;
+}
+
+/* pick a placement and a path to it */
+/* get the action that takes the falling piece along its path, finding a new path if gravity has pulled it off the old one */
+static bool follow_path(const sim_data &sim, const placement &target, piece *path, int &path_len, int &path_pos, uint8_t &action) {
+    /* find where the piece is along the path */
+    const piece &p = sim.next_pieces[0];
+    int k = path_pos;
+    while(k < path_len && !(path[k].rotation == p.rotation && path[k].position.x == p.position.x && path[k].position.y == p.position.y)) k++;
+    if(k == path_len) {
+        path_len = find_path(sim, target, path);
+        if(path_len == 0) return false; // there's no way there anymore
+        k = 0;
+    }
+    path_pos = k;
+
+    /* drop straight down once there's nothing else to do */
+    bool down_only = true;
+    for(int i = k + 1; i < path_len && down_only; i++) down_only = (path[i].rotation == p.rotation && path[i].position.x == p.position.x);
+    if(down_only) {
+        action = ACTION_HARD_DROP;
+        return true;
+    }
+
+    const piece &next = path[k + 1];
+    if(next.rotation != p.rotation) action = ACTION_ROTATE; // this may come with a wall kick, which the path has already accounted for
+    else if(next.position.x < p.position.x) action = ACTION_LEFT;
+    else if(next.position.x > p.position.x) action = ACTION_RIGHT;
+    else action = ACTION_DOWN;
+    return true;
+}
+
+/* check that the falling piece gets to a placement before it's locked, by playing it out on a copy of the simulation */
+static bool rehearse_placement(const sim_data &sim, const placement &target, piece *path) {
+    sim_data placed, test;
+    copy_sim(placed, sim); apply_placement(placed, target);
+    copy_sim(test, sim);
+
+    int path_len = 0, path_pos = 0;
+    uint8_t action;
+    while(!test.game_over && test.next_pieces.head == sim.next_pieces.head) {
+        if(!follow_path(test, target, path, path_len, path_pos, action)) return false;
+        step_sim(test, action);
+    }
+
+    return test.game_over == placed.game_over && test.field_key == placed.field_key;
+}
+
+/* pick a placement for the falling piece, out of those that it can get to in time */
+static void plan_ai(ai_player &ai, const sim_data &sim) {
+    placement_list all, reachable;
+    generate_placements(sim, all);
+    reachable.count = 0;
+    for(int i = 0; i < all.count; i++) {
+        if(rehearse_placement(sim, all.placements[i], ai.path)) reachable.placements[reachable.count++] = all.placements[i];
+    }
+
+    ai_result result = ai_search(sim, ai.options, ai.pool, (reachable.count > 0) ? &reachable : &all);
+    ai.planned = true; ai.head = sim.next_pieces.head;
+    ai.target = result.target;
+    ai.path_len = (result.found) ? find_path(sim, ai.target, ai.path) : 0;
+    ai.path_pos = 0;
+}
+
+/* get the AI player's actions for this frame */
+uint8_t ai_actions(ai_player &ai, const sim_data &sim) {
+    if(!ai.enabled || sim.game_over) return 0;
+    if(!ai.planned || ai.head != sim.next_pieces.head) plan_ai(ai, sim); // a new piece has come in
+
+    uint8_t action;
+    if(!follow_path(sim, ai.target, ai.path, ai.path_len, ai.path_pos, action)) {
+        /* pick another placement, or just drop the piece if there's nowhere to go */
+        plan_ai(ai, sim);
+        if(!follow_path(sim, ai.target, ai.path, ai.path_len, ai.path_pos, action)) action = ACTION_HARD_DROP;
+    }
+    return action;
+}
+
+/* run AI player games from the command line */
+int ai_main(int argc, char *argv[]) {
+    int games = (argc > 2) ? atoi(argv[2]) : 10;
+    uint64_t max_pieces = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 10000;
+    int threads = (argc > 4) ? atoi(argv[4]) : 0;
+    uint64_t seed = (argc > 5) ? strtoull(argv[5], nullptr, 10) : 0;
+    ai_options options = new_ai_options();
+    options.time_budget_ms = 0; // flat out
+    if(argc > 6) options.beam_width = atoi(argv[6]);
+    if(argc > 7) options.time_budget_ms = atof(argv[7]);
+    if(games <= 0 || options.beam_width <= 0) {
+        write_line("Usage: " + string(argv[0]) + " --ai [games] [max pieces] [threads] [seed] [beam width] [time budget (ms, 0 for none)]");
+        return 1;
+    }
+
+    thread_pool pool;
+    start_thread_pool(pool, threads);
+    write_line("Games: " + to_string(games) + ", threads: " + to_string(pool_threads(pool)) + ", beam width: " + to_string(options.beam_width) + ", depth: " + to_string(MIN(options.depth, NEXT_PIECES_CNT)));
+
+    auto start = chrono::steady_clock::now();
+    uint64_t total_pieces = 0, total_nodes = 0;
+    long long total_score = 0;
+    for(int g = 0; g < games; g++) {
+        sim_data sim = new_sim(0, seed + g);
+        uint64_t pieces = 0;
+        while(!sim.game_over && pieces < max_pieces) {
+            ai_result result = ai_search(sim, options, &pool);
+            if(!result.found) break;
+            apply_placement(sim, result.target);
+            pieces++;
+            total_nodes += result.nodes;
+        }
+
+        write_line("Game " + to_string(g) + ": " + to_string(pieces) + " pieces, score " + to_string(sim.score) + ", level " + to_string(sim.level) + ((sim.game_over) ? " (game over)" : ""));
+        total_pieces += pieces; total_score += sim.score;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stop_thread_pool(pool);
+
+    write_line("Pieces: " + to_string(total_pieces) + ", total score: " + to_string(total_score));
+    write_line("Time: " + to_string(seconds) + " s, " + to_string((long long)(total_pieces / seconds)) + " pieces/s, " + to_string((long long)(total_nodes / seconds)) + " nodes/s");
+
+    return 0;
+}
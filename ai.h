@@ -0,0 +1,133 @@
+#ifndef AI_H
+#define AI_H
+
+#include "sim.h"
+#include "movegen.h"
+#include "eval.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * @brief The maximum number of moves in an AI player's path to its target placement. A path never visits a position twice, so this covers every position on the default playing field.
+ *
+ */
+#define AI_PATH_MAX             (4 * (FIELD_MAX_HEIGHT_16 + MOVEGEN_ROWS_ABOVE) * (field_traits<uint16_t>::max_width + 4))
+
+/**
+ * @brief AI player options.
+ *
+ * @field weights The board evaluation weights.
+ * @field beam_width The number of states kept on each ply of the beam search.
+ * @field depth The number of pieces to look ahead (including the falling piece), capped at NEXT_PIECES_CNT.
+ * @field time_budget_ms The time budget for each search (in milliseconds), or 0 for none. Once it runs out, the search stops and goes with what it's found on the last finished ply.
+ *
+ */
+struct ai_options {
+    ai_weights weights;
+    int beam_width;
+    int depth;
+    double time_budget_ms;
+};
+
+/**
+ * @brief AI search results.
+ *
+ * @field found Set if a placement has been found, i.e. if the falling piece has any placements at all.
+ * @field target The picked placement of the falling piece.
+ * @field score The score of the best state found, which the target placement leads to.
+ * @field depth The number of plies that the search finished.
+ * @field nodes The number of states evaluated.
+ *
+ */
+struct ai_result {
+    bool found;
+    placement target;
+    double score;
+    int depth;
+    uint64_t nodes;
+};
+
+/**
+ * @brief AI player controller, which plays the interactive game by picking a placement for each new piece and feeding it the actions to get there.
+ *
+ * @field options The AI player options.
+ * @field pool The thread pool to run searches on, or nullptr to run them on the calling thread.
+ * @field enabled Set when the AI player is in control.
+ * @field planned Set when a placement has been picked for the falling piece.
+ * @field head The next pieces queue head when the placement was picked, which tells when the falling piece has changed.
+ * @field target The picked placement.
+ * @field path The falling piece's positions along the way to the target placement, one move apart.
+ * @field path_len The number of positions in the path.
+ * @field path_pos The index of the falling piece's position in the path, as of the last frame.
+ *
+ */
+struct ai_player {
+    ai_options options;
+    thread_pool *pool;
+
+    bool enabled;
+    bool planned;
+    uint8_t head;
+    placement target;
+
+    piece path[AI_PATH_MAX];
+    int path_len;
+    int path_pos;
+};
+
+/**
+ * @brief Create AI player options with default values; see the AI_* macros in config.h.
+ *
+ * @return ai_options The AI player options.
+ */
+ai_options new_ai_options();
+
+/**
+ * @brief Pick a placement for a simulation's falling piece with a beam search over the placements of it and the next pieces. Each ply expands every state in the beam by all placements of its falling piece (in parallel, if a thread pool is given), and keeps the best states, with states reached by different placement orders kept only once.
+ *
+ * @param sim The simulation data structure.
+ * @param options The AI player options.
+ * @param pool The thread pool to expand the beam on, or nullptr to run on the calling thread.
+ * @param candidates The falling piece's placements to pick from, or nullptr to pick from all of them.
+ * @return ai_result The search results.
+ */
+ai_result ai_search(const sim_data &sim, const ai_options &options, thread_pool *pool = nullptr, const placement_list *candidates = nullptr);
+
+/**
+ * @brief Find the shortest sequence of left, right, down moves and rotations (following the same rules as handle_sim_input()) that takes a simulation's falling piece to a placement. Out of the shortest sequences, the one that makes its rotations and left/right moves the furthest up is picked, as the piece could be locked by gravity whenever it's resting on something.
+ *
+ * @param sim The simulation data structure.
+ * @param target The placement, which must be reachable (e.g. one returned by generate_placements()).
+ * @param path The falling piece's positions along the way, starting with where it is now and ending at the placement. This must have room for AI_PATH_MAX positions.
+ * @return int The number of positions in the path, or 0 if the placement can't be reached.
+ */
+int find_path(const sim_data &sim, const placement &target, piece *path);
+
+/**
+ * @brief Create an AI player controller. The controller is disabled until its enabled field is set.
+ *
+ * @param pool The thread pool to run searches on, or nullptr to run them on the calling thread.
+ * @return ai_player The AI player controller.
+ */
+ai_player new_ai_player(thread_pool *pool = nullptr);
+
+/**
+ * @brief Get an AI player's actions for a simulation's current frame, in place of the player's input. A placement is picked whenever a new piece comes in (out of those that it can be taken to before it's locked, with the input speed limits and gravity played out on a copy of the simulation), and the piece is then moved along the path to it one action at a time (as the input speed limits allow), and hard dropped once only down moves are left. If gravity pulls the piece off the path, a new path is found.
+ *
+ * @param ai The AI player controller.
+ * @param sim The simulation data structure.
+ * @return uint8_t The actions for the frame; see handle_sim_input().
+ */
+uint8_t ai_actions(ai_player &ai, const sim_data &sim);
+
+/**
+ * @brief Run AI player games from the command line as fast as possible (placing pieces straight away, without frames), and print the results. Usage: --ai [games] [max pieces] [threads] [seed] [beam width] [time budget (ms, 0 for none)]
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return int The program's return value.
+ */
+int ai_main(int argc, char *argv[]);
+
+#endif
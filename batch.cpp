@@ -0,0 +1,184 @@
+#include "batch.h"
+#include "replay.h"
+#include "lanes.h"
+#include "utils.h"
+#include "splashkit.h"
+#include <sys/stat.h>
+
+using namespace std;
+
+/**
+ * @brief The number of games that each batch runner task advances.
+ *
+ */
+#define BATCH_CHUNK_GAMES       8
+
+/**
+ * @brief A headless game in a batch.
+ *
+ * @field sim The game's simulation state.
+ * @field rng The game's policy pseudorandom number generator.
+ * @field frames The number of frames the game has been run for.
+ * @field replay The game's input recorder, if the batch is being recorded.
+ *
+ */
+struct batch_game {
+    sim_data sim;
+    rng_state rng;
+    uint64_t frames;
+    replay_recorder replay;
+};
+
+/* press random buttons */
+uint8_t random_policy(const sim_data &, rng_state &rng) {
+    return (uint8_t)(rng_next(rng) & (ACTION_LEFT | ACTION_RIGHT | ACTION_DOWN | ACTION_ROTATE | ACTION_SWAP));
+}
+
+/* create default batch options */
+batch_options new_batch_options(int games) {
+    batch_options result;
+
+    result.games = games;
+    result.level = 0;
+    result.seed = 0;
+    result.max_frames = 1 << 20;
+    result.threads = 0;
+    result.sync_frames = 0;
+    result.lanes = false;
+    result.policy = random_policy;
+
+    return result;
+}
+
+/* advance a game by up to the given number of frames, returning whether it can still go on */
+static bool advance_game(batch_game &game, const batch_options &options, uint64_t frames) {
+    uint64_t end = MIN(game.frames + frames, options.max_frames);
+    bool recording = !options.replay_dir.empty();
+    while(game.frames < end && !game.sim.game_over) {
+        uint8_t actions = options.policy(game.sim, game.rng);
+        if(recording) record_frame(game.replay, game.sim, actions);
+        step_sim(game.sim, actions);
+        game.frames++;
+    }
+    return game.frames < options.max_frames && !game.sim.game_over;
+}
+
+/* run a batch of games */
+batch_result run_batch(thread_pool &pool, const batch_options &options) {
+    auto start = chrono::steady_clock::now();
+
+    vector<batch_game> games(options.games);
+    pool_parallel_for(pool, games.size(), BATCH_CHUNK_GAMES, [&games, &options](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            games[i].sim = new_sim(options.level, options.seed + i);
+            games[i].rng = new_rng(~(options.seed + i)); // keep the policy's numbers apart from the pieces'
+            games[i].frames = 0;
+            if(!options.replay_dir.empty()) games[i].replay = new_recorder(games[i].sim);
+        }
+    });
+
+    if(options.lanes) {
+        /* SIMD lanes: step each group of SIM_LANES games together until all of them are done */
+        pool_parallel_for(pool, games.size(), SIM_LANES, [&games, &options](size_t begin, size_t end) {
+            sim_lanes lanes = new_lanes();
+            for(size_t i = begin; i < end; i++) add_lane(lanes, games[i].sim);
+
+            bool recording = !options.replay_dir.empty();
+            uint8_t actions[SIM_LANES] = {};
+            while(true) {
+                uint32_t active = 0;
+                for(int i = 0; i < lanes.count; i++) {
+                    batch_game &game = games[begin + i];
+                    if(game.frames < options.max_frames && !game.sim.game_over) {
+                        actions[i] = options.policy(game.sim, game.rng);
+                        if(recording) record_frame(game.replay, game.sim, actions[i]);
+                        active |= 1u << i;
+                    }
+                }
+                if(!active) break;
+
+                step_lanes(lanes, actions, active);
+                for(int i = 0; i < lanes.count; i++) games[begin + i].frames += (active >> i) & 1;
+            }
+        });
+    } else if(options.sync_frames) {
+        /* lockstep: advance every game by sync_frames at a time until none are left running */
+        atomic<size_t> running(games.size());
+        while(running > 0) {
+            running = 0;
+            pool_parallel_for(pool, games.size(), BATCH_CHUNK_GAMES, [&games, &options, &running](size_t begin, size_t end) {
+                size_t n = 0;
+                for(size_t i = begin; i < end; i++) {
+                    if(games[i].frames < options.max_frames && !games[i].sim.game_over && advance_game(games[i], options, options.sync_frames)) n++;
+                }
+                running += n;
+            });
+        }
+    } else {
+        /* free-running: play each game to its end, letting idle workers steal the remaining chunks */
+        pool_parallel_for(pool, games.size(), BATCH_CHUNK_GAMES, [&games, &options](size_t begin, size_t end) {
+            for(size_t i = begin; i < end; i++) advance_game(games[i], options, options.max_frames);
+        });
+    }
+
+    if(!options.replay_dir.empty()) {
+        /* finish and save the games' replays */
+        struct stat buffer;
+        if(stat(options.replay_dir.c_str(), &buffer) != 0) mkdir(options.replay_dir.c_str()); // create replays folder
+
+        atomic<int> failed(0);
+        pool_parallel_for(pool, games.size(), BATCH_CHUNK_GAMES, [&games, &options, &failed](size_t begin, size_t end) {
+            for(size_t i = begin; i < end; i++) {
+                finish_recording(games[i].replay, games[i].sim);
+                if(!save_replay(games[i].replay, options.replay_dir + "/" + to_string(options.seed + i) + REPLAY_EXTENSION)) failed++;
+                games[i].replay = replay_recorder(); // free it now rather than with the rest of the batch
+            }
+        });
+        if(failed) write_line("Cannot save " + to_string(failed) + " replays to " + options.replay_dir);
+    }
+
+    /* aggregate results, in game order so that the hash doesn't depend on scheduling */
+    batch_result result;
+    result.games = options.games; result.games_over = 0;
+    result.frames = 0; result.score = 0; result.hash = 0;
+    for(const batch_game &game : games) {
+        result.games_over += game.sim.game_over;
+        result.frames += game.frames;
+        result.score += game.sim.score;
+        result.hash = (result.hash ^ sim_hash(game.sim)) * 0x100000001b3ULL;
+    }
+
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/* run a batch from the command line */
+int batch_main(int argc, char *argv[]) {
+    batch_options options = new_batch_options((argc > 2) ? atoi(argv[2]) : 1000);
+    if(argc > 3) options.max_frames = strtoull(argv[3], nullptr, 10);
+    if(argc > 4) options.threads = atoi(argv[4]);
+    if(argc > 5) options.seed = strtoull(argv[5], nullptr, 10);
+    if(argc > 6) options.sync_frames = strtoull(argv[6], nullptr, 10);
+    if(argc > 7) options.lanes = atoi(argv[7]) != 0;
+    if(argc > 8) options.replay_dir = argv[8];
+    if(options.games <= 0) {
+        write_line("Usage: " + string(argv[0]) + " --batch [games] [max frames] [threads] [seed] [sync frames] [lanes (0/1)] [replay folder]");
+        return 1;
+    }
+
+    thread_pool pool;
+    start_thread_pool(pool, options.threads);
+    batch_result result = run_batch(pool, options);
+    int threads = pool_threads(pool);
+    stop_thread_pool(pool);
+
+    write_line("Games: " + to_string(result.games) + " (" + to_string(result.games_over) + " game over), threads: " + to_string(threads) + ", mode: " + ((options.lanes) ? ("SIMD lanes (" + to_string(SIM_LANES) + " games)") : (options.sync_frames) ? ("lockstep (" + to_string(options.sync_frames) + " frames)") : string("free-running")));
+    write_line("Frames: " + to_string(result.frames) + ", total score: " + to_string(result.score));
+    write_line("Time: " + to_string(result.seconds) + " s, " + to_string((long long)(result.games / result.seconds)) + " games/s, " + to_string((long long)(result.frames / result.seconds)) + " frames/s");
+
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)result.hash);
+    write_line("State hash: " + string(hash));
+
+    return 0;
+}
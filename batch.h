@@ -0,0 +1,100 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "sim.h"
+#include "rng.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * @brief Player policy for headless games: picks the actions for a simulation's next frame.
+ *
+ * @param sim The simulation data structure.
+ * @param rng The game's own pseudorandom number generator, for policies that need one. This is separate from the simulation's, so that the policy never changes the pieces that a seed produces.
+ * @return uint8_t The actions for the frame; see handle_sim_input().
+ */
+typedef function<uint8_t(const sim_data &sim, rng_state &rng)> batch_policy;
+
+/**
+ * @brief Batch runner options.
+ *
+ * @field games The number of games to run.
+ * @field level The games' starting level.
+ * @field seed The base seed; game i is seeded with seed + i, so any single game can be reproduced on its own.
+ * @field max_frames The maximum number of frames to run each game for, if it doesn't end earlier.
+ * @field threads The number of worker threads; 0 picks the number of hardware threads.
+ * @field sync_frames Lockstep mode: when set, all games are advanced this many frames at a time, and wait for each other between rounds. Otherwise, each game runs to completion independently (free-running mode).
+ * @field lanes SIMD lanes mode: when set, games are stepped SIM_LANES at a time in lockstep through step_lanes(), and each group runs to completion independently. This overrides sync_frames.
+ * @field policy The player policy; see random_policy() for the default.
+ * @field replay_dir When set, each game is recorded and saved to this folder as a replay named after its seed, so that the games can be played back and checked later (see verify_main()).
+ *
+ */
+struct batch_options {
+    int games;
+    int level;
+    uint64_t seed;
+    uint64_t max_frames;
+    int threads;
+    uint64_t sync_frames;
+    bool lanes;
+    batch_policy policy;
+    string replay_dir;
+};
+
+/**
+ * @brief Batch runner results.
+ *
+ * @field games The number of games that have been run.
+ * @field games_over The number of games that ended in a game over (as opposed to running out of frames).
+ * @field frames The total number of frames simulated across all games.
+ * @field score The total score across all games.
+ * @field hash A combined hash of all games' final states (see sim_hash()), for checking runs against each other.
+ * @field seconds The wall clock time taken to run the games.
+ *
+ */
+struct batch_result {
+    int games;
+    int games_over;
+    uint64_t frames;
+    long long score;
+    uint64_t hash;
+    double seconds;
+};
+
+/**
+ * @brief The default player policy, which presses random buttons.
+ *
+ * @param sim The simulation data structure.
+ * @param rng The game's policy pseudorandom number generator.
+ * @return uint8_t The actions for the frame.
+ */
+uint8_t random_policy(const sim_data &sim, rng_state &rng);
+
+/**
+ * @brief Create batch runner options with default values.
+ *
+ * @param games The number of games to run.
+ * @return batch_options The batch runner options.
+ */
+batch_options new_batch_options(int games);
+
+/**
+ * @brief Run a batch of headless games in parallel on a thread pool.
+ *
+ * @param pool The thread pool to run the games on.
+ * @param options The batch runner options.
+ * @return batch_result The aggregated results.
+ */
+batch_result run_batch(thread_pool &pool, const batch_options &options);
+
+/**
+ * @brief Run a batch of headless games from the command line and print the results. Usage: --batch [games] [max frames] [threads] [seed] [sync frames] [lanes (0/1)] [replay folder]
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return int The program's return value.
+ */
+int batch_main(int argc, char *argv[]);
+
+#endif
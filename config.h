@@ -11,6 +11,18 @@
  */
 // #define DEBUG_INPUT_REJECTIONS
 
+/**
+ * @brief Macro directive to play back each replay as soon as it's recorded, and print whether it doesn't match the game.
+ * 
+ */
+// #define DEBUG_REPLAYS
+
+/**
+ * @brief Macro directive to check the incrementally kept Zobrist keys against ones worked out from scratch, after every placement and every snapshot (which is read back to check it).
+ * 
+ */
+// #define DEBUG_ZOBRIST
+
 /* COMMON GAME OPTIONS */
 
 /**
@@ -44,11 +56,23 @@
 #define GAME_BG_COLOR                   COLOR_BLUE
 
 /**
- * @brief The game's frame rate (in frames per second).
+ * @brief The game's display frame rate (in frames per second), which drawing and the title screen are paced at.
  * 
  */
 #define FRAME_RATE                      60
 
+/**
+ * @brief The simulation's tick rate (in ticks per second). The game is simulated in fixed ticks at this rate whatever the display frame rate is, so that slow or dropped frames never change the game's timing; the simulation's frame counters (and replays) count these ticks.
+ * 
+ */
+#define SIM_RATE                        240
+
+/**
+ * @brief The most simulation ticks that are run for a single displayed frame. If the game falls further behind than that (e.g. while the window is being dragged), the rest of the time is skipped instead of being caught up on in a burst.
+ * 
+ */
+#define SIM_MAX_TICKS_PER_FRAME         (SIM_RATE / 4)
+
 /**
  * @brief The number of pieces in the next pieces queue, including the falling piece.
  * 
@@ -88,17 +112,35 @@
 #define FIELD_BG_COLOR                  COLOR_BLACK
 
 /**
- * @brief The playing field's width (in cells). Tetris guidelines call for 10 columns.
+ * @brief The playing field's default width (in cells). Tetris guidelines call for 10 columns. This is the width of the interactive game's playing field; headless games can be created with other dimensions (see new_sim()).
  * 
  */
 #define FIELD_WIDTH                     10
 
 /**
- * @brief The playing field's height (in cells). Tetris guidelines call for 20 columns.
+ * @brief The playing field's default height (in cells). Tetris guidelines call for 20 columns. This is the height of the interactive game's playing field; headless games can be created with other dimensions (see new_sim()).
  * 
  */
 #define FIELD_HEIGHT                    20
 
+/**
+ * @brief The maximum playing field height (in cells) for fields using 16-bit bitboard rows (i.e. up to 16 columns wide).
+ * 
+ */
+#define FIELD_MAX_HEIGHT_16             32
+
+/**
+ * @brief The maximum playing field height (in cells) for fields using 32-bit bitboard rows (i.e. up to 32 columns wide).
+ * 
+ */
+#define FIELD_MAX_HEIGHT_32             128
+
+/**
+ * @brief The maximum playing field height (in cells) for fields using 64-bit bitboard rows (i.e. up to 64 columns wide).
+ * 
+ */
+#define FIELD_MAX_HEIGHT_64             512
+
 /**
  * @brief The HUD's top left border corner X coordinate. Set to -1 to center the HUD to the right half.
  * 
@@ -203,6 +245,12 @@
  */
 #define PIECE_BORDER_COLOR              COLOR_BLACK
 
+/**
+ * @brief Show the ghost piece, i.e. an outline of where the falling piece would land on a hard drop. Comment this out to hide it.
+ * 
+ */
+#define GHOST_PIECE
+
 /**
  * @brief Colour for the cyan (I) block.
  * 
@@ -253,6 +301,12 @@
  */
 #define SCORE_FORCE_DOWN                1
 
+/**
+ * @brief Points added for each row that a piece falls by on a hard drop action.
+ * 
+ */
+#define SCORE_HARD_DROP                 2
+
 /**
  * @brief Points added when a single row has been cleared.
  * 
@@ -309,6 +363,12 @@
  */
 #define SPEED_STEP                      0.25
 
+/**
+ * @brief The maximum falling speed (in rows per simulation tick). The default of 20 rows per tick (20G) drops pieces instantly on the default playing field.
+ * 
+ */
+#define SPEED_MAX_ROWS                  20
+
 /**
  * @brief Side moving speed (in moves per second).
  * 
@@ -327,6 +387,12 @@
  */
 #define SPEED_INPUT_ROTATE              4
 
+/**
+ * @brief Hard dropping speed (in drops per second).
+ * 
+ */
+#define SPEED_INPUT_HARD_DROP           4
+
 /**
  * @brief Piece swapping speed (in swaps per second).
  * 
@@ -339,6 +405,12 @@
  */
 #define SPEED_INPUT_MENU                4
 
+/**
+ * @brief The delay before held left/right keys start repeating (in milliseconds), both in game and on the title screen; they then repeat at the speeds above. The down key repeats straight away, and rotation, swapping and hard dropping don't repeat.
+ * 
+ */
+#define INPUT_DAS_MS                    170
+
 /* GAME OVER */
 
 /**
@@ -365,8 +437,100 @@
  */
 #define GAME_OVER_TEXT_SIZE             18
 
+/* AI PLAYER */
+
+/**
+ * @brief The number of states kept on each ply of the AI player's beam search.
+ * 
+ */
+#define AI_BEAM_WIDTH                   32
+
+/**
+ * @brief The number of pieces that the AI player's beam search looks ahead (including the falling piece). This is capped at NEXT_PIECES_CNT, as the AI only gets to see the pieces that the player can see.
+ * 
+ */
+#define AI_DEPTH                        NEXT_PIECES_CNT
+
+/**
+ * @brief The AI player's time budget for picking each piece's placement (in milliseconds). This has to stay well within a displayed frame (1000 / FRAME_RATE ms) for the AI to play live; searches that take longer than a simulation tick are caught up on within the frame.
+ * 
+ */
+#define AI_TIME_BUDGET_MS               8
+
+/* REPLAYS */
+
+/**
+ * @brief Macro directive to record every game's inputs to a replay file; can be commented to disable recording.
+ * 
+ */
+#define RECORD_REPLAYS
+
+/**
+ * @brief The folder that replay files are saved to.
+ * 
+ */
+#define REPLAY_DIR                      "Resources/replays"
+
+/**
+ * @brief The replay files' extension.
+ * 
+ */
+#define REPLAY_EXTENSION                ".trpl"
+
+/**
+ * @brief The number of frames (simulation ticks) between the keyframes (full game state snapshots) that replays are recorded with, which bounds how many frames have to be simulated to seek to any point of a replay; 0 records no keyframes.
+ * 
+ */
+#define REPLAY_KEYFRAME_INTERVAL        (30 * SIM_RATE)
+
+/* REWIND */
+
+/**
+ * @brief Macro directive to let the player step back through the game's recent states with the R key; can be commented to disable rewinding.
+ * 
+ */
+#define REWIND
+
+/**
+ * @brief The number of states (one for each merged piece) that the rewind buffer can hold.
+ * 
+ */
+#define REWIND_STATES                   512
+
+/**
+ * @brief The size of the rewind buffer's storage for its states' deltas (in bytes).
+ * 
+ */
+#define REWIND_ARENA_SIZE               (256 * 1024)
+
+/**
+ * @brief How far back the player can rewind (in seconds); older states are dropped from the rewind buffer.
+ * 
+ */
+#define REWIND_SECONDS                  60
+
+/* SAVE STATES */
+
+/**
+ * @brief Macro directive to save the game when the player quits in the middle of it, and resume it on the next launch; can be commented to disable saving.
+ * 
+ */
+#define SAVE_STATE
+
+/**
+ * @brief The file that the game is saved to when the player quits in the middle of it.
+ * 
+ */
+#define SAVE_STATE_FILE                 "Resources/savestate.tsav"
+
 /* DERIVED VALUES */
 
+/**
+ * @brief The length of a simulation tick (in milliseconds).
+ * 
+ */
+#define SIM_TICK_MS                     (1000.0 / SIM_RATE)
+
 /**
  * @brief The total width of the playing field's content (in pixels).
  * 
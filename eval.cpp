@@ -0,0 +1,265 @@
+#include "eval.h"
+#include "movegen.h"
+#include "rng.h"
+#include "utils.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/* the vector type that the kernel works with, which holds one 16-bit bitboard row (or column top) of EVAL_VEC_LANES boards, and the operations it uses */
+#if defined(__AVX2__)
+typedef __m256i eval_vec;
+#define EVAL_VEC_LANES          16
+static inline eval_vec eval_load(const uint16_t *p) { return _mm256_load_si256((const __m256i *)p); }
+static inline void eval_store(uint16_t *p, eval_vec a) { _mm256_store_si256((__m256i *)p, a); }
+static inline eval_vec eval_set1(uint16_t x) { return _mm256_set1_epi16((short)x); }
+static inline eval_vec eval_and(eval_vec a, eval_vec b) { return _mm256_and_si256(a, b); }
+static inline eval_vec eval_andnot(eval_vec a, eval_vec b) { return _mm256_andnot_si256(a, b); }
+static inline eval_vec eval_or(eval_vec a, eval_vec b) { return _mm256_or_si256(a, b); }
+static inline eval_vec eval_xor(eval_vec a, eval_vec b) { return _mm256_xor_si256(a, b); }
+static inline eval_vec eval_add(eval_vec a, eval_vec b) { return _mm256_add_epi16(a, b); }
+static inline eval_vec eval_subs(eval_vec a, eval_vec b) { return _mm256_subs_epu16(a, b); }
+static inline eval_vec eval_max(eval_vec a, eval_vec b) { return _mm256_max_epu16(a, b); }
+static inline eval_vec eval_shr1(eval_vec a) { return _mm256_srli_epi16(a, 1); }
+static inline eval_vec eval_is_zero(eval_vec a) { return _mm256_cmpeq_epi16(a, _mm256_setzero_si256()); }
+
+/* count each lane's bits by looking up each nibble's count in a shuffle table */
+static inline eval_vec eval_popcount(eval_vec a) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(a, nibble)), _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(a, 4), nibble)));
+    return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0xFF)), _mm256_srli_epi16(bytes, 8));
+}
+#elif defined(__SSE2__)
+typedef __m128i eval_vec;
+#define EVAL_VEC_LANES          8
+static inline eval_vec eval_load(const uint16_t *p) { return _mm_load_si128((const __m128i *)p); }
+static inline void eval_store(uint16_t *p, eval_vec a) { _mm_store_si128((__m128i *)p, a); }
+static inline eval_vec eval_set1(uint16_t x) { return _mm_set1_epi16((short)x); }
+static inline eval_vec eval_and(eval_vec a, eval_vec b) { return _mm_and_si128(a, b); }
+static inline eval_vec eval_andnot(eval_vec a, eval_vec b) { return _mm_andnot_si128(a, b); }
+static inline eval_vec eval_or(eval_vec a, eval_vec b) { return _mm_or_si128(a, b); }
+static inline eval_vec eval_xor(eval_vec a, eval_vec b) { return _mm_xor_si128(a, b); }
+static inline eval_vec eval_add(eval_vec a, eval_vec b) { return _mm_add_epi16(a, b); }
+static inline eval_vec eval_subs(eval_vec a, eval_vec b) { return _mm_subs_epu16(a, b); }
+static inline eval_vec eval_max(eval_vec a, eval_vec b) { return _mm_max_epi16(a, b); } // only used on column tops, which are well within the signed range
+static inline eval_vec eval_shr1(eval_vec a) { return _mm_srli_epi16(a, 1); }
+static inline eval_vec eval_is_zero(eval_vec a) { return _mm_cmpeq_epi16(a, _mm_setzero_si128()); }
+
+/* count each lane's bits with the usual SWAR steps (SSE2 has no byte shuffles to look them up with) */
+static inline eval_vec eval_popcount(eval_vec a) {
+    a = _mm_sub_epi16(a, _mm_and_si128(_mm_srli_epi16(a, 1), _mm_set1_epi16(0x5555)));
+    a = _mm_add_epi16(_mm_and_si128(a, _mm_set1_epi16(0x3333)), _mm_and_si128(_mm_srli_epi16(a, 2), _mm_set1_epi16(0x3333)));
+    a = _mm_and_si128(_mm_add_epi16(a, _mm_srli_epi16(a, 4)), _mm_set1_epi16(0x0F0F));
+    return _mm_and_si128(_mm_add_epi16(a, _mm_srli_epi16(a, 8)), _mm_set1_epi16(0x1F));
+}
+#else
+/* scalar fallback: a single lane */
+typedef uint16_t eval_vec;
+#define EVAL_VEC_LANES          1
+static inline eval_vec eval_load(const uint16_t *p) { return *p; }
+static inline void eval_store(uint16_t *p, eval_vec a) { *p = a; }
+static inline eval_vec eval_set1(uint16_t x) { return x; }
+static inline eval_vec eval_and(eval_vec a, eval_vec b) { return a & b; }
+static inline eval_vec eval_andnot(eval_vec a, eval_vec b) { return ~a & b; }
+static inline eval_vec eval_or(eval_vec a, eval_vec b) { return a | b; }
+static inline eval_vec eval_xor(eval_vec a, eval_vec b) { return a ^ b; }
+static inline eval_vec eval_add(eval_vec a, eval_vec b) { return a + b; }
+static inline eval_vec eval_subs(eval_vec a, eval_vec b) { return (a > b) ? a - b : 0; }
+static inline eval_vec eval_max(eval_vec a, eval_vec b) { return MAX(a, b); }
+static inline eval_vec eval_shr1(eval_vec a) { return a >> 1; }
+static inline eval_vec eval_is_zero(eval_vec a) { return (a) ? 0 : 0xFFFF; }
+static inline eval_vec eval_popcount(eval_vec a) { return (eval_vec)__builtin_popcount(a); }
+#endif
+
+static_assert(EVAL_LANES % EVAL_VEC_LANES == 0, "EVAL_LANES must be a multiple of the vector width");
+
+/* get the bits of a row's leftmost and rightmost columns, which are next to the walls */
+static inline uint16_t edge_columns(uint16_t row_full) {
+    return 1 | (row_full ^ (row_full >> 1));
+}
+
+/* measure playing field features */
+board_features measure_board(const sim_data &sim) {
+    board_features result = {0, 0, 0, 0, 0, 0};
+
+    /* the column heights' features, with walls as high as the playing field */
+    int y_top = sim.field_height;
+    for(int x = 0; x < sim.field_width; x++) {
+        int top = sim.column_tops[x];
+        y_top = MIN(y_top, top);
+        result.height += sim.field_height - top;
+        if(x > 0) result.bumpiness += abs(top - sim.column_tops[x - 1]);
+
+        int left = (x > 0) ? sim.column_tops[x - 1] : 0, right = (x < sim.field_width - 1) ? sim.column_tops[x + 1] : 0;
+        result.wells += MAX(top - MAX(left, right), 0);
+    }
+
+    /* the rows' features; the rows above the top are all empty, so they add nothing */
+    const uint16_t inner = sim.row_full >> 1, edges = edge_columns(sim.row_full);
+    uint16_t covered = 0, above = 0;
+    for(int y = y_top; y < sim.field_height; y++) {
+        uint16_t row = sim.field_rows[y];
+        if(row) result.row_transitions += __builtin_popcount((row ^ (row >> 1)) & inner) + __builtin_popcount(edges & ~row);
+        result.column_transitions += __builtin_popcount(row ^ above);
+        result.holes += __builtin_popcount(covered & ~row); // an empty cell under any occupied cell, i.e. one that's covered by the rows above
+        covered |= row; above = row;
+    }
+    result.column_transitions += __builtin_popcount(sim.row_full & ~above); // the floor
+
+    return result;
+}
+
+/* measure a group of up to EVAL_LANES playing fields' features */
+static void measure_group(const sim_data *const *sims, int count, board_features *results) {
+    const sim_data &first = *sims[0];
+    const int width = first.field_width, height = first.field_height;
+
+    /* lay the boards' bitboard rows and column tops out side by side, with walls (whose tops are at the top of the field) on both sides; unused lanes get empty boards */
+    alignas(32) uint16_t rows[FIELD_MAX_HEIGHT_16][EVAL_LANES];
+    alignas(32) uint16_t tops[field_traits<uint16_t>::max_width + 2][EVAL_LANES];
+    int y_top = height;
+    for(int i = 0; i < EVAL_LANES; i++) {
+        tops[0][i] = tops[width + 1][i] = 0;
+        for(int x = 0; x < width; x++) {
+            tops[x + 1][i] = (i < count) ? sims[i]->column_tops[x] : (uint16_t)height;
+            y_top = MIN(y_top, (int)tops[x + 1][i]);
+        }
+    }
+    for(int y = y_top; y < height; y++) {
+        for(int i = 0; i < EVAL_LANES; i++) rows[y][i] = (i < count) ? sims[i]->field_rows[y] : 0;
+    }
+
+    const eval_vec full = eval_set1(first.row_full), inner = eval_set1(first.row_full >> 1), edges = eval_set1(edge_columns(first.row_full));
+    alignas(32) uint16_t features[6][EVAL_LANES];
+    for(int base = 0; base < count; base += EVAL_VEC_LANES) {
+        const eval_vec zero = eval_set1(0);
+
+        /* the rows' features, from the highest top down; the aggregate height adds up how many columns have been reached on each row */
+        eval_vec covered = zero, above = zero, holes = zero, aggregate = zero, row_transitions = zero, column_transitions = zero;
+        for(int y = y_top; y < height; y++) {
+            eval_vec row = eval_load(&rows[y][base]);
+            eval_vec across = eval_add(eval_popcount(eval_and(eval_xor(row, eval_shr1(row)), inner)), eval_popcount(eval_andnot(row, edges)));
+            row_transitions = eval_add(row_transitions, eval_andnot(eval_is_zero(row), across)); // empty rows don't count
+            column_transitions = eval_add(column_transitions, eval_popcount(eval_xor(row, above)));
+            holes = eval_add(holes, eval_popcount(eval_andnot(row, covered)));
+            covered = eval_or(covered, row); above = row;
+            aggregate = eval_add(aggregate, eval_popcount(covered));
+        }
+        column_transitions = eval_add(column_transitions, eval_popcount(eval_andnot(above, full))); // the floor
+
+        /* the column heights' features; tops grow downwards, so a well is as deep as its top is below the higher neighbour's */
+        eval_vec bumpiness = zero, wells = zero;
+        for(int x = 1; x <= width; x++) {
+            eval_vec top = eval_load(&tops[x][base]), left = eval_load(&tops[x - 1][base]), right = eval_load(&tops[x + 1][base]);
+            if(x > 1) bumpiness = eval_add(bumpiness, eval_or(eval_subs(top, left), eval_subs(left, top)));
+            wells = eval_add(wells, eval_subs(top, eval_max(left, right)));
+        }
+
+        eval_store(&features[0][base], aggregate);
+        eval_store(&features[1][base], holes);
+        eval_store(&features[2][base], bumpiness);
+        eval_store(&features[3][base], wells);
+        eval_store(&features[4][base], row_transitions);
+        eval_store(&features[5][base], column_transitions);
+    }
+
+    for(int i = 0; i < count; i++) {
+        board_features &result = results[i];
+        result.height = features[0][i];
+        result.holes = features[1][i];
+        result.bumpiness = features[2][i];
+        result.wells = features[3][i];
+        result.row_transitions = features[4][i];
+        result.column_transitions = features[5][i];
+    }
+}
+
+/* measure many playing fields' features */
+void measure_boards(const sim_data *const *sims, int count, board_features *results) {
+    for(int i = 0; i < count; i += EVAL_LANES) measure_group(sims + i, MIN(count - i, EVAL_LANES), results + i);
+}
+
+/* evaluate playing field */
+double evaluate_board(const sim_data &sim, const ai_weights &weights) {
+    return score_features(measure_board(sim), weights);
+}
+
+/* evaluate many playing fields */
+void evaluate_boards(const sim_data *const *sims, int count, const ai_weights &weights, double *scores) {
+    board_features features[EVAL_LANES];
+    for(int i = 0; i < count; i += EVAL_LANES) {
+        int group = MIN(count - i, EVAL_LANES);
+        measure_group(sims + i, group, features);
+        for(int j = 0; j < group; j++) scores[i + j] = score_features(features[j], weights);
+    }
+}
+
+/* benchmark the evaluation kernel against the scalar reference */
+int bench_eval_main(int argc, char *argv[]) {
+    int boards = (argc > 2) ? atoi(argv[2]) : 4096;
+    int rounds = (argc > 3) ? atoi(argv[3]) : 200;
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 0;
+    if(boards <= 0 || rounds <= 0) {
+        write_line("Usage: " + string(argv[0]) + " --bench-eval [boards] [rounds] [seed]");
+        return 1;
+    }
+
+    /* build up boards by placing random numbers of pieces at random */
+    vector<sim_data> sims(boards);
+    vector<const sim_data *> pointers(boards);
+    rng_state rng = new_rng(seed);
+    placement_list list;
+    for(int i = 0; i < boards; i++) {
+        sim_data &sim = sims[i];
+        sim = new_sim(0, seed + i);
+        for(int pieces = rng_range(rng, 0, 40); pieces > 0; pieces--) {
+            if(generate_placements(sim, list) == 0) break;
+            sim_data next;
+            copy_sim(next, sim);
+            apply_placement(next, list.placements[rng_range(rng, 0, list.count - 1)]);
+            if(next.game_over) break;
+            copy_sim(sim, next);
+        }
+        pointers[i] = &sim;
+    }
+
+    /* check that both agree */
+    vector<board_features> features(boards);
+    measure_boards(pointers.data(), boards, features.data());
+    for(int i = 0; i < boards; i++) {
+        board_features expected = measure_board(sims[i]);
+        if(memcmp(&expected, &features[i], sizeof(board_features))) {
+            write_line("Mismatch on board " + to_string(i));
+            return 1;
+        }
+    }
+
+    /* time both, keeping a checksum (which should come back to zero) so that nothing is optimized away */
+    long long checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for(int r = 0; r < rounds; r++) {
+        for(int i = 0; i < boards; i++) checksum += measure_board(sims[i]).holes;
+    }
+    double scalar_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for(int r = 0; r < rounds; r++) {
+        measure_boards(pointers.data(), boards, features.data());
+        for(int i = 0; i < boards; i++) checksum -= features[i].holes;
+    }
+    double vector_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double measured = (double)boards * rounds;
+    write_line("Boards: " + to_string(boards) + ", rounds: " + to_string(rounds) + ", vector width: " + to_string(EVAL_VEC_LANES) + " boards (of " + to_string(EVAL_LANES) + " per group)");
+    write_line("Scalar: " + to_string(scalar_seconds) + " s, " + to_string((long long)(measured / scalar_seconds)) + " boards/s");
+    write_line("Vector: " + to_string(vector_seconds) + " s, " + to_string((long long)(measured / vector_seconds)) + " boards/s (" + to_string(scalar_seconds / vector_seconds) + "x)");
+    write_line("Checksum: " + to_string(checksum) + ((checksum) ? " (mismatch)" : ""));
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "sim.h"
+
+using namespace std;
+
+/**
+ * @brief The number of boards that measure_boards() measures together, i.e. the number of 16-bit bitboard rows in a 256-bit AVX2 register. Narrower vector units work through each group in several steps.
+ *
+ */
+#define EVAL_LANES              16
+
+/**
+ * @brief Board evaluation weights. Each feature is multiplied by its weight, and the results are added up into the board's score (higher is better).
+ *
+ * @field height The weight of the aggregate height, i.e. the sum of all columns' heights.
+ * @field holes The weight of the number of holes, i.e. empty cells with an occupied cell somewhere above them.
+ * @field bumpiness The weight of the bumpiness, i.e. the sum of height differences between neighbouring columns.
+ * @field wells The weight of the well depths, i.e. how far each column is below both of its neighbours (or walls).
+ * @field row_transitions The weight of the row transitions, i.e. the number of times an occupied cell is next to an empty one along a non-empty row (with the walls counted as occupied).
+ * @field column_transitions The weight of the column transitions, i.e. the number of times an occupied cell is above or below an empty one along a column (with the floor counted as occupied).
+ * @field score The weight of each point scored on the way to the board, which rewards clearing rows (and clearing more of them at once).
+ *
+ */
+struct ai_weights {
+    double height;
+    double holes;
+    double bumpiness;
+    double wells;
+    double row_transitions;
+    double column_transitions;
+    double score;
+};
+
+/**
+ * @brief Board features, as used for evaluation; see ai_weights for their meanings.
+ *
+ */
+struct board_features {
+    int height;
+    int holes;
+    int bumpiness;
+    int wells;
+    int row_transitions;
+    int column_transitions;
+};
+
+/**
+ * @brief Measure a simulation's playing field features, one board at a time. This is the scalar reference for measure_boards().
+ *
+ * @param sim The simulation data structure.
+ * @return board_features The playing field's features.
+ */
+board_features measure_board(const sim_data &sim);
+
+/**
+ * @brief Measure many simulations' playing field features at once. The boards are worked through EVAL_LANES at a time, with their bitboard rows and column heights laid out side by side so that each feature is worked out for all of them with the same vector instructions (AVX2 or SSE2, whichever the build targets, or plain integer code without either).
+ *
+ * @param sims The simulation data structures, which must all have the same playing field dimensions.
+ * @param count The number of simulations.
+ * @param results The playing fields' features, in the same order. This must have room for count entries.
+ */
+void measure_boards(const sim_data *const *sims, int count, board_features *results);
+
+/**
+ * @brief Score a board's features.
+ *
+ * @param features The board's features.
+ * @param weights The evaluation weights.
+ * @return double The board's score (higher is better), not counting the points scored; see ai_weights.
+ */
+inline double score_features(const board_features &features, const ai_weights &weights) {
+    return weights.height * features.height + weights.holes * features.holes + weights.bumpiness * features.bumpiness + weights.wells * features.wells
+         + weights.row_transitions * features.row_transitions + weights.column_transitions * features.column_transitions;
+}
+
+/**
+ * @brief Evaluate a simulation's playing field.
+ *
+ * @param sim The simulation data structure.
+ * @param weights The evaluation weights.
+ * @return double The playing field's score (higher is better), not counting the points scored; see ai_weights.
+ */
+double evaluate_board(const sim_data &sim, const ai_weights &weights);
+
+/**
+ * @brief Evaluate many simulations' playing fields at once; see measure_boards().
+ *
+ * @param sims The simulation data structures, which must all have the same playing field dimensions.
+ * @param count The number of simulations.
+ * @param weights The evaluation weights.
+ * @param scores The playing fields' scores, in the same order. This must have room for count entries.
+ */
+void evaluate_boards(const sim_data *const *sims, int count, const ai_weights &weights, double *scores);
+
+/**
+ * @brief Benchmark the board evaluation kernel against the scalar reference from the command line, checking that they agree, and print the results. Usage: --bench-eval [boards] [rounds] [seed]
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return int The program's return value.
+ */
+int bench_eval_main(int argc, char *argv[]);
+
+#endif
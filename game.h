@@ -4,8 +4,12 @@
 #include "splashkit.h"
 
 #include "piece.h"
+#include "sim.h"
+#include "ai.h"
+#include "replay.h"
+#include "rewind.h"
+#include "input.h"
 #include "config.h"
-#include <deque>
 
 using namespace std;
 
@@ -35,134 +39,88 @@ struct hud_drawing_options {
 };
 
 /**
- * @brief The game data structure.
- * 
- * @field score The player's score.
- * @field level The player's level (zero-based).
- * 
- * @field score_lvlup The player's score on the last level increment.
- * 
- * @field playing_field The playing field.
- * @field next_pieces The falling and next pieces queue.
- * 
- * @field frame_num The current frame number.
- * 
- * @field frame_last_update The frame number of the last game update (in normal operations mode).
- * 
- * @field frame_last_move The frame number of the last accepted left/right move action.
- * @field frame_last_down The frame number of the last accepted down move action.
- * @field frame_last_rotate The frame number of the last accepted rotation action.
- * @field frame_last_swap The frame number of the last accepted piece swap action.
+ * @brief The game's presentation state: everything that is only needed to draw the game and run its menus, and that never affects the simulation.
  * 
  * @field hud_options HUD drawing options.
  * 
- * @field game_over Game over flag.
  * @field game_over_filled Set after the playing field has been filled for the game over screen.
- * @field frame_game_over The frame number where the game over condition was detected.
+ * @field fill_count The number of rows that have been filled so far for the game over screen. The next row is due on frame frame_game_over + (fill_count + 1) * (SIM_RATE / GAME_OVER_FILL_RATE).
  * @field show_scoreboard Set when the game scoreboard is to be shown after asking the player to add their score.
  * 
  * @field scoreboard The scoreboard database. This is only opened upon setting of game_over_filled, and is closed when the game returns back to the title screen.
  * 
  */
-struct game_data {
-    int score;
-    int level;
-
-    int score_lvlup;
-
-    piece_colour playing_field[FIELD_HEIGHT][FIELD_WIDTH];
-    deque<piece> next_pieces;
-
-    uint64_t frame_num;
-
-    uint64_t frame_last_update;
-
-    /* input */
-    uint64_t frame_last_move;
-    uint64_t frame_last_down;
-    uint64_t frame_last_rotate;
-    uint64_t frame_last_swap;
-
+struct game_view {
     /* HUD */
     hud_drawing_options hud_options;
 
     /* game over */
-    bool game_over;
     bool game_over_filled;
-    uint64_t frame_game_over;
+    int fill_count;
     bool show_scoreboard;
 
     database scoreboard;
 };
 
 /**
- * @brief Removed rows information.
+ * @brief The game data structure.
  * 
- * @field flags Array of flags indicating which rows have been removed.
- * @field count The number of removed rows.
+ * @field sim The game's simulation state (playing field, pieces, score, level, RNG and frame counters). This is plain data, and can be copied, compared and hashed on its own; see copy_sim(), sim_equal() and sim_hash().
+ * @field view The game's presentation state.
+ * @field ai The AI player controller, which plays in place of the player while it's enabled.
+ * @field replay The game's input recorder, which records the actions applied on each frame (whether they come from the player or the AI player) until the game is over.
+ * @field rewind The game's recent states, captured whenever a piece is merged, for the player to step back through.
  * 
  */
-struct removed_rows {
-    bool flags[FIELD_HEIGHT];
-    int count;
+struct game_data {
+    sim_data sim;
+    game_view view;
+    ai_player ai;
+    replay_recorder replay;
+    rewind_buffer rewind;
 };
 
 /**
  * @brief Create a new game given the starting level.
  * 
  * @param level The game's starting level (defaults to 1st level).
+ * @param pool The thread pool for the AI player to search on (optional).
  * @return game_data The created game data structure.
  */
-game_data new_game(int level = 0);
+game_data new_game(int level = 0, thread_pool *pool = nullptr);
 
 /**
  * @brief Create a new game given the settings JSON struct to load the level from.
  * 
  * @param settings The settings JSON structure.
+ * @param pool The thread pool for the AI player to search on (optional).
  * @return game_data The created game data structure.
  */
-game_data new_game(json settings);
-
-/**
- * @brief Bitmask for left side collision. Returned by check_collision().
- * 
- */
-#define COLLISION_LEFT          (1 << 0)
+game_data new_game(json settings, thread_pool *pool = nullptr);
 
 /**
- * @brief Bitmask for right side collision. Returned by check_collision().
- * 
- */
-#define COLLISION_RIGHT         (1 << 1)
-
-/**
- * @brief Bitmask for ceiling collision. Returned by check_collision().
- * 
- */
-#define COLLISION_CEILING       (1 << 2)
-
-/**
- * @brief Bitmask for bottom (or floor) collision. Returned by check_collision().
+ * @brief Finish the game's input recording, if it hasn't been finished yet, and save it to a new file in REPLAY_DIR named after the time and the game's seed. This is done when the game is over, or when the player quits in the middle of it.
  * 
+ * @param game The game data structure.
  */
-#define COLLISION_BOTTOM        (1 << 3)
+void save_game_replay(game_data &game);
 
 /**
- * @brief Check for collision between a test piece and a game's playing field.
+ * @brief Save the game's state to SAVE_STATE_FILE (see write_save_state()), for resume_game() to pick it up on the next launch. This is done when the player quits in the middle of the game; if the game is over, any old save is deleted instead.
  * 
- * @param game The game whose playing field will be used to check against.
- * @param test_piece The test piece to check against.
- * @return uint8_t Collision status flags; see COLLISION_LEFT, COLLISION_RIGHT, COLLISION_CEILING and COLLISION_BOTTOM.
+ * @param game The game data structure.
  */
-uint8_t check_collision(const game_data &game, const piece &test_piece);
+void save_game_state(const game_data &game);
 
 /**
- * @brief Check for collision between the falling piece in a game and the playing field.
+ * @brief Resume the game saved in SAVE_STATE_FILE, if there's one, and delete the save so that it's only resumed once. The resumed game isn't recorded, as its replay couldn't be played back from its seed.
  * 
- * @param game The game data structure to check.
- * @return uint8_t Collision status flags; see COLLISION_LEFT, COLLISION_RIGHT, COLLISION_CEILING and COLLISION_BOTTOM.
+ * @param game The game data structure to set up.
+ * @param pool The thread pool for the AI player to search on (optional).
+ * @return true Returned if a game has been resumed.
+ * @return false Returned if there's no valid save.
  */
-uint8_t check_collision(const game_data &game);
+bool resume_game(game_data &game, thread_pool *pool = nullptr);
 
 /**
  * @brief Handle inputs during game over.
@@ -175,42 +133,7 @@ uint8_t check_collision(const game_data &game);
 bool handle_game_over(game_data &game);
 
 /**
- * @brief Handle left move action.
- * 
- * @param game The game data structure.
- */
-void handle_left_move(game_data &game);
-
-/**
- * @brief Handle right move action.
- * 
- * @param game The game data structure.
- */
-void handle_right_move(game_data &game);
-
-/**
- * @brief Handle down move action.
- * 
- * @param game The game data structure.
- */
-void handle_down_move(game_data &game);
-
-/**
- * @brief Handle piece rotation.
- * 
- * @param game The game data structure.
- */
-void handle_rotate(game_data &game);
-
-/**
- * @brief Handle piece swapping action.
- * 
- * @param game The game data structure.
- */
-void handle_swap(game_data &game);
-
-/**
- * @brief Handle user inputs.
+ * @brief Handle user inputs that aren't simulation actions (the AI player and rewind keys, and the game over screen); this is called once on each displayed frame. The player's actions are taken in by update_game() on each simulation tick instead.
  * 
  * @param game The game data structure.
  * @return true Returned if the game can proceed as normal.
@@ -254,46 +177,7 @@ void draw_game_over(const game_data &game);
 void draw_game(const game_data &game);
 
 /**
- * @brief Merge a game's falling piece into its playing field.
- * 
- * @param game The game data structure.
- */
-void merge_piece(game_data &game);
-
-/**
- * @brief Detect and remove filled rows in a game's playing field.
- * 
- * @param game The game data structure.
- * @return removed_rows A data structure containing information on the removed rows.
- */
-removed_rows remove_full_rows(game_data &game);
-
-/**
- * @brief Award score to the player depending on the number and pattern of removed filled rows.
- * 
- * @param game The game data structure.
- * @param rows Information on removed rows, returned by remove_full_rows().
- */
-void award_score(game_data &game, const removed_rows &rows);
-
-/**
- * @brief Pop the falling piece out of the game's next pieces queue and add a new one to its end.
- * 
- * @param game The game data structure.
- */
-void next_piece(game_data &game);
-
-/**
- * @brief Check for the game over condition.
- * 
- * @param game The game data structure.
- * @return true Returned on game over (i.e. the falling piece is overflowing from the playing field)/
- * @return false Returned if the game can proceed as usual.
- */
-bool check_game_over(const game_data &game);
-
-/**
- * @brief Perform the game's logic; this is called on each frame.
+ * @brief Perform the game's logic for a simulation tick, applying the player's (or the AI player's) actions for it; this is called SIM_RATE times per second, independently of the display frame rate.
  * 
  * @param game The game data structure.
  */
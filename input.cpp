@@ -0,0 +1,85 @@
+#include "input.h"
+#include "utils.h"
+
+using namespace std;
+
+/* the key event queue, which SplashKit's callbacks (which don't take any context) write into */
+static input_event input_queue[INPUT_QUEUE_SIZE];
+static size_t queue_head = 0, queue_count = 0;
+
+/* the key states */
+static key_state key_states[INPUT_KEY_CODES];
+static double input_now = 0;
+
+/* get the current time */
+double input_clock() {
+    static const auto start = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/* queue a key event, timed by when process_events() hands it over, as SplashKit doesn't pass the system's event time on */
+static void queue_event(int key, bool down) {
+    if(key < 0 || key >= INPUT_KEY_CODES || queue_count == INPUT_QUEUE_SIZE) return;
+    input_queue[(queue_head + queue_count++) % INPUT_QUEUE_SIZE] = {key, down, input_clock()};
+}
+
+/* SplashKit key callbacks */
+static void on_key_down(int code) {
+    queue_event(code, true);
+}
+
+static void on_key_up(int code) {
+    queue_event(code, false);
+}
+
+/* start queueing key events */
+void start_input() {
+    input_clock(); // start the clock
+    register_callback_on_key_down(on_key_down);
+    register_callback_on_key_up(on_key_up);
+}
+
+/* stop queueing key events */
+void stop_input() {
+    deregister_callback_on_key_down(on_key_down);
+    deregister_callback_on_key_up(on_key_up);
+}
+
+/* apply the queued key events */
+void update_input(double until) {
+    while(queue_count > 0 && input_queue[queue_head].time <= until) {
+        const input_event &event = input_queue[queue_head];
+        key_state &state = key_states[event.key];
+
+        if(event.down) {
+            if(!state.held) { // the system's own key repeat sends more presses while the key is held, which aren't new presses
+                state.held = true;
+                if(state.presses < UINT8_MAX) state.presses++;
+                state.press_time = event.time;
+            }
+        } else state.held = false;
+
+        queue_head = (queue_head + 1) % INPUT_QUEUE_SIZE;
+        queue_count--;
+    }
+    if(until > input_now) input_now = until; // the time never goes back, even if the caller's clock mapping does
+}
+
+/* take a key press */
+bool input_pressed(key_code key) {
+    if(key < 0 || key >= INPUT_KEY_CODES || key_states[key].presses == 0) return false;
+    key_states[key].presses--;
+    return true;
+}
+
+/* check whether a key has been held down for long enough */
+bool input_held(key_code key, double delay) {
+    if(key < 0 || key >= INPUT_KEY_CODES) return false;
+    const key_state &state = key_states[key];
+    return state.held && input_now - state.press_time >= delay;
+}
+
+/* drop the presses that haven't been taken */
+void clear_input_presses() {
+    for(key_state &state : key_states) state.presses = 0;
+}
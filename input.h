@@ -0,0 +1,99 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "splashkit.h"
+
+using namespace std;
+
+/**
+ * @brief The number of key events that can be queued between two calls to update_input(). Events past that are dropped.
+ *
+ */
+#define INPUT_QUEUE_SIZE        256
+
+/**
+ * @brief The number of key codes that key states are kept for; SplashKit's key codes all fall below this.
+ *
+ */
+#define INPUT_KEY_CODES         (POWER_KEY + 1)
+
+/**
+ * @brief A key press or release, as received from SplashKit while processing events.
+ *
+ * @field key The key's code.
+ * @field down Set for a press, cleared for a release.
+ * @field time When the event has been received (in milliseconds; see input_clock()). SplashKit's callbacks don't pass the system's event times on, so this is when process_events() handed the event over: all events received over a displayed frame get about the same time, and their order is all that's known within the frame.
+ *
+ */
+struct input_event {
+    int key;
+    bool down;
+    double time;
+};
+
+/**
+ * @brief A key's state, as of the last update_input() call.
+ *
+ * @field held Set while the key is held down.
+ * @field presses The number of presses that haven't been taken yet (see input_pressed()), which counts presses shorter than a frame just as well.
+ * @field press_time When the key has last been pressed (in milliseconds; see input_clock()).
+ *
+ */
+struct key_state {
+    bool held;
+    uint8_t presses;
+    double press_time;
+};
+
+/**
+ * @brief Get the input clock's current time, which key events are timestamped with as they're handed over by process_events() (so with a displayed frame's granularity).
+ *
+ * @return double The time (in milliseconds), on a monotonic clock.
+ */
+double input_clock();
+
+/**
+ * @brief Start queueing key events, by registering key press and release callbacks with SplashKit. This is to be called once the window is open.
+ *
+ */
+void start_input();
+
+/**
+ * @brief Stop queueing key events.
+ *
+ */
+void stop_input();
+
+/**
+ * @brief Apply the queued key events received up to a given time to the key states, in the order they came in. Later events are left queued for the next call.
+ *
+ * @param until The time (in milliseconds; see input_clock()) that the key states are to be brought up to, which is taken as the current time by input_held() (unless it's earlier than a previous call's).
+ */
+void update_input(double until);
+
+/**
+ * @brief Take one of a key's presses, if it has any left. Each press is taken once, however short it was, so a caller that can't act on it right away can leave it for later.
+ *
+ * @param key The key's code.
+ * @return true Returned if a press has been taken.
+ * @return false Returned if the key hasn't been pressed since its presses were last taken.
+ */
+bool input_pressed(key_code key);
+
+/**
+ * @brief Check whether a key has been held down for at least a given time, e.g. for starting auto-repeat after a delay.
+ *
+ * @param key The key's code.
+ * @param delay The time that the key has to be held for (in milliseconds).
+ * @return true Returned if the key is held down, and has been for at least the delay.
+ * @return false Returned otherwise.
+ */
+bool input_held(key_code key, double delay);
+
+/**
+ * @brief Drop all keys' presses that haven't been taken yet, e.g. those made while something else had control.
+ *
+ */
+void clear_input_presses();
+
+#endif
@@ -0,0 +1,160 @@
+#include "lanes.h"
+#include "utils.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/* the actions that each timer throttles; the last timer is gravity's */
+static const uint8_t timer_actions[LANE_TIMERS - 1] = {ACTION_LEFT | ACTION_RIGHT, ACTION_DOWN, ACTION_ROTATE, ACTION_SWAP, ACTION_HARD_DROP};
+
+/* the number of frames until an action is accepted again, as a lane timer */
+static inline uint16_t input_wait(const sim_data &sim, uint64_t frame_last, int speed) {
+    if(input_ready(sim, frame_last, speed)) return 0;
+    return (uint16_t)(frame_last + SIM_RATE / speed - sim.frame_num);
+}
+
+/* set a lane's timers up from its game */
+static void refresh_lane(sim_lanes &lanes, int lane) {
+    const sim_data &sim = *lanes.sims[lane];
+    if(sim.game_over) {
+        /* nothing can happen anymore, so the lane only needs its frame counter advanced */
+        for(int t = 0; t < LANE_TIMERS; t++) lanes.timers[t][lane] = UINT16_MAX;
+        lanes.rejected[lane] = UINT8_MAX;
+        return;
+    }
+
+    lanes.timers[0][lane] = input_wait(sim, sim.frame_last_move, SPEED_INPUT_MOVE);
+    lanes.timers[1][lane] = input_wait(sim, sim.frame_last_down, SPEED_INPUT_FORCE_DOWN);
+    lanes.timers[2][lane] = input_wait(sim, sim.frame_last_rotate, SPEED_INPUT_ROTATE);
+    lanes.timers[3][lane] = input_wait(sim, sim.frame_last_swap, SPEED_INPUT_SWAP);
+    lanes.timers[4][lane] = input_wait(sim, sim.frame_last_hard_drop, SPEED_INPUT_HARD_DROP);
+    lanes.timers[5][lane] = (uint16_t)((gravity_due(sim)) ? 0 : MIN(sim.frame_next_update - sim.frame_num, (uint64_t)UINT16_MAX));
+}
+
+/* create an empty lanes group */
+sim_lanes new_lanes() {
+    sim_lanes result;
+    memset(result.timers, 0, sizeof(result.timers));
+    memset(result.rejected, 0, sizeof(result.rejected));
+    result.count = 0;
+    return result;
+}
+
+/* add a game to a lanes group */
+int add_lane(sim_lanes &lanes, sim_data &sim) {
+    int lane = lanes.count++;
+    lanes.sims[lane] = &sim;
+    lanes.rejected[lane] = 0;
+    refresh_lane(lanes, lane);
+    return lane;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+/* find the lanes whose timer has run out, as a byte of set bits per lane */
+static inline __m128i timer_out(const sim_lanes &lanes, int timer) {
+#if defined(__AVX2__)
+    __m256i zero = _mm256_cmpeq_epi16(_mm256_load_si256((const __m256i *)lanes.timers[timer]), _mm256_setzero_si256());
+    return _mm_packs_epi16(_mm256_castsi256_si128(zero), _mm256_extracti128_si256(zero, 1));
+#else
+    __m128i zero_lo = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *)&lanes.timers[timer][0]), _mm_setzero_si128());
+    __m128i zero_hi = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *)&lanes.timers[timer][8]), _mm_setzero_si128());
+    return _mm_packs_epi16(zero_lo, zero_hi);
+#endif
+}
+#endif
+
+/* find the lanes with anything to do on this frame: an action that's accepted or hasn't been rejected yet, or a gravity step */
+static uint32_t busy_lanes(const sim_lanes &lanes, const uint8_t *actions) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    /* turn each action timer that has run out into its actions' bits */
+    __m128i ready = _mm_setzero_si128();
+    for(int t = 0; t < LANE_TIMERS - 1; t++) ready = _mm_or_si128(ready, _mm_and_si128(timer_out(lanes, t), _mm_set1_epi8((char)timer_actions[t])));
+    __m128i due = timer_out(lanes, LANE_TIMERS - 1);
+
+    /* requested actions that are ready and not known to be rejected */
+    __m128i work = _mm_andnot_si128(_mm_load_si128((const __m128i *)lanes.rejected), _mm_and_si128(_mm_loadu_si128((const __m128i *)actions), ready));
+    uint32_t idle = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(work, _mm_setzero_si128()));
+    return (~idle | (uint32_t)_mm_movemask_epi8(due)) & ((1u << SIM_LANES) - 1);
+#else
+    uint32_t result = 0;
+    for(int i = 0; i < SIM_LANES; i++) {
+        uint8_t ready = 0;
+        for(int t = 0; t < LANE_TIMERS - 1; t++) {
+            if(!lanes.timers[t][i]) ready |= timer_actions[t];
+        }
+        if((actions[i] & ready & ~lanes.rejected[i]) || !lanes.timers[LANE_TIMERS - 1][i]) result |= 1u << i;
+    }
+    return result;
+#endif
+}
+
+/* count a frame off the timers of the given lanes */
+static void tick_lanes(sim_lanes &lanes, uint32_t ticking) {
+#if defined(__AVX2__)
+    const __m256i bits = _mm256_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, (short)32768);
+    __m256i one = _mm256_srli_epi16(_mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16((short)ticking), bits), bits), 15); // 1 in the ticking lanes, 0 in the others
+    for(int t = 0; t < LANE_TIMERS; t++) {
+        __m256i *timer = (__m256i *)lanes.timers[t];
+        _mm256_store_si256(timer, _mm256_subs_epu16(_mm256_load_si256(timer), one));
+    }
+#elif defined(__SSE2__)
+    const __m128i bits = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    __m128i one_lo = _mm_srli_epi16(_mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16((short)(ticking & 0xFF)), bits), bits), 15);
+    __m128i one_hi = _mm_srli_epi16(_mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16((short)(ticking >> 8)), bits), bits), 15);
+    for(int t = 0; t < LANE_TIMERS; t++) {
+        __m128i *timer = (__m128i *)lanes.timers[t];
+        _mm_store_si128(timer, _mm_subs_epu16(_mm_load_si128(timer), one_lo));
+        _mm_store_si128(timer + 1, _mm_subs_epu16(_mm_load_si128(timer + 1), one_hi));
+    }
+#else
+    for(uint32_t m = ticking; m; m &= m - 1) {
+        int i = __builtin_ctz(m);
+        for(int t = 0; t < LANE_TIMERS; t++) {
+            if(lanes.timers[t][i]) lanes.timers[t][i]--;
+        }
+    }
+#endif
+}
+
+/* step a lane's game through the scalar code, and keep track of the actions that it rejects; known rejections are still passed on, as an earlier action on the same frame may make them fit */
+static void step_lane(sim_lanes &lanes, int lane, uint8_t actions) {
+    sim_data &sim = *lanes.sims[lane];
+
+    /* the falling piece, next pieces queue and playing field, which are all that rejections depend on */
+    piece falling = sim.next_pieces[0];
+    uint8_t head = sim.next_pieces.head;
+    uint64_t field_key = sim.field_key;
+
+    step_sim(sim, actions);
+
+    const piece &now = sim.next_pieces[0];
+    if(now.type == falling.type && now.rotation == falling.rotation && now.position.x == falling.position.x && now.position.y == falling.position.y && sim.next_pieces.head == head && sim.field_key == field_key) {
+        /* nothing has changed, so every action that was tested has been rejected */
+        uint8_t tested = 0;
+        for(int t = 0; t < LANE_TIMERS - 1; t++) {
+            if(!lanes.timers[t][lane]) tested |= timer_actions[t];
+        }
+        lanes.rejected[lane] |= actions & tested;
+    } else lanes.rejected[lane] = 0;
+
+    refresh_lane(lanes, lane);
+}
+
+/* advance lanes by one frame */
+void step_lanes(sim_lanes &lanes, const uint8_t *actions, uint32_t active) {
+    uint32_t busy = busy_lanes(lanes, actions) & active;
+    for(uint32_t m = busy; m; m &= m - 1) {
+        int i = __builtin_ctz(m);
+        step_lane(lanes, i, actions[i]);
+    }
+
+    /* the other lanes have nothing to do on this frame, as step_sim() would find */
+    uint32_t idle = active & ~busy;
+    for(uint32_t m = idle; m; m &= m - 1) lanes.sims[__builtin_ctz(m)]->frame_num++;
+    tick_lanes(lanes, idle);
+}
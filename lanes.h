@@ -0,0 +1,63 @@
+#ifndef LANES_H
+#define LANES_H
+
+#include "sim.h"
+
+using namespace std;
+
+/**
+ * @brief The number of games (lanes) that are stepped together by step_lanes(). With 16-bit timers, one timer of every lane fills a 256-bit AVX2 register.
+ *
+ */
+#define SIM_LANES               16
+
+/**
+ * @brief The number of timers kept for each lane: one per speed limited action (left and right moves share theirs), and one for gravity.
+ *
+ */
+#define LANE_TIMERS             6
+
+/**
+ * @brief A group of games stepped in lockstep. For each lane, it keeps the number of frames until each of its speed limited actions is accepted again and until its next gravity step, in a structure-of-arrays layout, so that finding the lanes with anything to do on a frame takes a few vector instructions across all lanes.
+ *
+ * The games themselves stay in their own sim_data structures, which remain complete and valid at all times; the lanes group only keeps its timers and rejected actions, which are refreshed from a lane's game whenever step_sim() has been run on it.
+ *
+ * @field timers The lanes' timers: timers[t][i] is the number of frames until timer t of lane i runs out, capped at 65535 (which only makes a lane get stepped early). The timers are, in order: left/right moves, down moves, rotation, swap, hard drop and gravity.
+ * @field rejected The actions that each lane's game is known to reject: actions that were tested and rejected since its falling piece, next pieces queue and playing field last changed, which would be rejected again until they do.
+ * @field sims The lanes' games.
+ * @field count The number of lanes in use.
+ *
+ */
+struct sim_lanes {
+    alignas(32) uint16_t timers[LANE_TIMERS][SIM_LANES];
+    alignas(16) uint8_t rejected[SIM_LANES];
+    sim_data *sims[SIM_LANES];
+    int count;
+};
+
+/**
+ * @brief Create an empty lanes group.
+ *
+ * @return sim_lanes The lanes group.
+ */
+sim_lanes new_lanes();
+
+/**
+ * @brief Add a game to a lanes group. The game must outlive the group, and must only be stepped through step_lanes() while it's in the group.
+ *
+ * @param lanes The lanes group, which must have fewer than SIM_LANES lanes in use.
+ * @param sim The game's simulation data structure.
+ * @return int The game's lane index.
+ */
+int add_lane(sim_lanes &lanes, sim_data &sim);
+
+/**
+ * @brief Advance some of a lanes group's games by a single frame. This has exactly the same effect on them as calling step_sim() on each of them, but only does so for the lanes where an action is accepted or tested for the first time, or gravity is due; the other lanes only have their frame counter advanced. A lane whose only requested actions are ones that it's known to reject isn't stepped, so DEBUG_INPUT_REJECTIONS doesn't report the same rejection on every frame.
+ *
+ * @param lanes The lanes group.
+ * @param actions The actions for each lane on this frame; see handle_sim_input(). This must hold SIM_LANES entries, although only the active lanes' are used.
+ * @param active Bitmask of the lanes to be stepped (bit i for lane i). The other lanes are left as they are.
+ */
+void step_lanes(sim_lanes &lanes, const uint8_t *actions, uint32_t active);
+
+#endif
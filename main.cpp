@@ -2,6 +2,11 @@
 #include "title.h"
 #include "settings.h"
 #include "config.h"
+#include "batch.h"
+#include "perft.h"
+#include "ai.h"
+#include "eval.h"
+#include "replay.h"
 
 /**
  * @brief Load resource bundle.
@@ -14,32 +19,53 @@ void load_resources() {
 /**
  * @brief The main function.
  * 
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments. Passing --batch runs headless games instead of the interactive game (see batch_main()), --perft runs the placement generator benchmark (see perft_main()), --ai runs headless AI player games (see ai_main()), --bench-eval runs the board evaluation benchmark (see bench_eval_main()), and --verify plays back and checks replay files (see verify_main()).
  * @return int The program's return value.
  */
-int main() {
+int main(int argc, char *argv[]) {
+    if(argc > 1 && string(argv[1]) == "--batch") return batch_main(argc, argv); // headless batch runner
+    if(argc > 1 && string(argv[1]) == "--perft") return perft_main(argc, argv); // placement generator benchmark
+    if(argc > 1 && string(argv[1]) == "--ai") return ai_main(argc, argv); // headless AI player
+    if(argc > 1 && string(argv[1]) == "--bench-eval") return bench_eval_main(argc, argv); // board evaluation benchmark
+    if(argc > 1 && string(argv[1]) == "--verify") return verify_main(argc, argv); // replay verification
+
     load_resources(); // load resource bundle
     
     open_window(WINDOW_TITLE, WINDOW_WIDTH, WINDOW_HEIGHT);
+    start_input(); // queue key events from here on
 
     bool game_started = false; // set when the game has started (i.e. no longer at title screen)
     game_data game;
 
+    thread_pool pool; // for the AI player
+    start_thread_pool(pool);
+
     json settings = load_settings(); // load settings from JSON file
 
     title_data title = new_title(settings);
 
+#ifdef SAVE_STATE
+    game_started = resume_game(game, &pool); // pick up where the player left off last time
+#endif
+    double sim_time = input_clock(); // the time that the game has been simulated up to (see input_clock())
+
     while(true) {
         while(!quit_requested()) {
             /* run game routines until the user stops playing or restarts the game after a game over */
             process_events();
+            double now = input_clock();
             
             if(!game_started) {
                 /* title screen */
+                update_input(now); // take in the key events that have just come in
                 // game_started = true; // TODO: add title screen
                 game_started = handle_title_input(title);
                 if(game_started) {
                     set_level(settings, title.level); // save level setting for persistence
-                    game = new_game(settings); // set up new game
+                    game = new_game(settings, &pool); // set up new game
+                    clear_input_presses(); // don't carry menu presses over into the game
+                    sim_time = now;
                 } else {
                     update_title(title);
                     draw_title(title);
@@ -51,8 +77,20 @@ int main() {
                     title = new_title(settings); // reinitialise title
                     break; // get back to title screen (i.e. game over)
                 }
-                update_game(game);
-                draw_game(game);
+
+                /* simulate the game up to now in fixed ticks; the key events that have just come in were received over the last displayed frame, but only carry the time they were handed over at, so the frame's ticks are mapped onto the input clock from that time on, and the first tick takes them all in */
+                double input_offset = now - sim_time; // the input clock's time at the frame's start, less its simulation time
+                for(int ticks = 0; sim_time + SIM_TICK_MS <= now; ticks++) {
+                    if(ticks == SIM_MAX_TICKS_PER_FRAME) {
+                        sim_time = now; // too far behind to catch up
+                        break;
+                    }
+                    sim_time += SIM_TICK_MS;
+                    update_input(sim_time + input_offset);
+                    update_game(game);
+                }
+
+                draw_game(game); // draw the latest state
             }
 
             refresh_screen(FRAME_RATE);
@@ -61,7 +99,18 @@ int main() {
         if(quit_requested()) break; // quit has been requested and it's not just a game over, so we need to exit
     }
 
+#ifdef RECORD_REPLAYS
+    if(game_started) save_game_replay(game); // the player has quit in the middle of a game
+#endif
+
+#ifdef SAVE_STATE
+    if(game_started) save_game_state(game); // the player has quit in the middle of a game
+#endif
+
     save_settings(settings); // commit changes to settings JSON file
 
+    stop_input();
+    stop_thread_pool(pool);
+
     return 0;
 }
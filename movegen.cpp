@@ -0,0 +1,127 @@
+#include "movegen.h"
+#include "utils.h"
+
+using namespace std;
+
+/* the horizontal wall kicks tried by handle_rotate(), in order */
+static constexpr int movegen_kicks[3] = {0, 1, -1};
+
+/* shift a bit mask left (positive amounts) or right (negative amounts) */
+template<typename row_t>
+static inline row_t shift_mask(row_t mask, int amount) {
+    return (amount >= 0) ? (row_t)(mask << amount) : (row_t)(mask >> -amount);
+}
+
+/* find where a rotation fits on a row, as a mask of its bounding box's left edge columns */
+template<typename row_t>
+static inline row_t fit_mask(const basic_sim_data<row_t> &sim, const piece_shape &shape, row_t edges, int y) {
+    row_t blocked = 0;
+    for(int i = 0; i < 4; i++) {
+        int field_y = y + shape.cell_y[i];
+        if(field_y < 0) continue; // above the playing field, where there's only the ceiling (which doesn't block anything)
+        if(field_y >= sim.field_height) return 0; // below the floor
+        blocked |= (row_t)(sim.field_rows[field_y] >> shape.cell_x[i]);
+    }
+    return edges & ~blocked;
+}
+
+/* generate all placements of the falling piece */
+template<typename row_t>
+int generate_placements(const basic_sim_data<row_t> &sim, basic_placement_list<row_t> &list) {
+    list.count = 0;
+    if(sim.game_over) return 0;
+
+    const piece &p = sim.next_pieces[0];
+    const piece_bitmap *bitmaps = piece_types[p.type].bitmaps;
+    const piece_shape *shapes = piece_shapes.shapes[p.type];
+
+    /* the piece's Y coordinate can only go down from where it is */
+    const int rows_max = field_traits<row_t>::max_height + MOVEGEN_ROWS_ABOVE;
+    int y_start = p.position.y, rows = sim.field_height - y_start;
+    if(rows <= 0 || rows > rows_max) return 0;
+
+    /* where each rotation fits on each row (with a blocked row at the end, for the landing test), and where it can be moved to */
+    row_t fits[4][rows_max + 1], reach[4][rows_max], lands[4][rows_max];
+    for(int r = 0; r < 4; r++) {
+        row_t edges = sim.row_full >> (bitmaps[r].width - 1); // the columns that the left edge can be in without crossing the walls
+        for(int i = 0; i < rows; i++) fits[r][i] = fit_mask(sim, shapes[r], edges, y_start + i);
+        fits[r][rows] = 0;
+    }
+    memset(reach, 0, sizeof(reach));
+
+    int left = p.position.x + bitmaps[p.rotation].x;
+    if(left < 0 || left >= field_traits<row_t>::max_width) return 0;
+    reach[p.rotation][0] = ((row_t)1 << left) & fits[p.rotation][0];
+    if(!reach[p.rotation][0]) return 0; // the piece doesn't fit where it is
+
+    for(int i = 0; i < rows; i++) {
+        /* spread out along the row with left/right moves and rotations, until nothing more can be reached */
+        bool changed = true;
+        while(changed) {
+            changed = false;
+            for(int r = 0; r < 4; r++) {
+                row_t m = reach[r][i], spread;
+                if(!m) continue;
+                while((spread = m | (((row_t)(m << 1) | (row_t)(m >> 1)) & fits[r][i])) != m) m = spread;
+                reach[r][i] = m;
+
+                /* rotate, trying each wall kick on the positions that the previous ones didn't fit */
+                int r_next = (r + 1) % 4, shift = bitmaps[r_next].x - bitmaps[r].x; // the left edge moves with the bounding box
+                row_t from = m, to = 0;
+                for(int kick = 0; kick < 3 && from; kick++) {
+                    int amount = shift + movegen_kicks[kick];
+                    row_t ok = from & shift_mask(fits[r_next][i], -amount);
+                    to |= shift_mask(ok, amount);
+                    from &= ~ok;
+                }
+                if(to & ~reach[r_next][i]) {
+                    reach[r_next][i] |= to;
+                    if(r_next < r) changed = true; // later rotations are still to be visited on this pass
+                }
+            }
+        }
+
+        /* move down to the next row, or land where that's blocked */
+        for(int r = 0; r < 4; r++) {
+            lands[r][i] = reach[r][i] & ~fits[r][i + 1];
+            if(i + 1 < rows) reach[r][i + 1] = reach[r][i] & fits[r][i + 1];
+        }
+    }
+
+    /* list the landing positions, skipping those already listed with another rotation of the same shape */
+    for(int r = 0; r < 4; r++) {
+        int canon = shapes[r].canon, dy = bitmaps[r].y - bitmaps[canon].y; // same cells means same bounding box
+        for(int i = 0; i < rows; i++) {
+            row_t m = lands[r][i];
+            if(canon != r && i + dy >= 0 && i + dy < rows) m &= ~lands[canon][i + dy];
+            for(; m; m &= m - 1) {
+                placement &target = list.placements[list.count++];
+                target.x = (int8_t)(__builtin_ctzll((uint64_t)m) - bitmaps[r].x);
+                target.rotation = (uint8_t)r;
+                target.y = (int16_t)(y_start + i);
+            }
+        }
+    }
+
+    return list.count;
+}
+
+/* lock the falling piece at a placement */
+template<typename row_t>
+void apply_placement(basic_sim_data<row_t> &sim, const placement &target) {
+    sim.next_pieces[0] = placement_piece(sim, target);
+    settle_piece(sim);
+
+#ifdef DEBUG_ZOBRIST
+    assert(zobrist_key(sim) == recalculate_zobrist_key(sim) && "incremental Zobrist key doesn't match the state after a placement");
+#endif
+}
+
+/* instantiate the placement generator for each bitboard row type */
+#define INSTANTIATE_MOVEGEN(row_t) \
+    template int generate_placements(const basic_sim_data<row_t> &sim, basic_placement_list<row_t> &list); \
+    template void apply_placement(basic_sim_data<row_t> &sim, const placement &target);
+
+INSTANTIATE_MOVEGEN(uint16_t)
+INSTANTIATE_MOVEGEN(uint32_t)
+INSTANTIATE_MOVEGEN(uint64_t)
@@ -0,0 +1,96 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "sim.h"
+
+using namespace std;
+
+/**
+ * @brief The number of rows above the playing field that the falling piece can be in when placements are generated. New pieces start at most 4 rows above the field, and swapped pieces at most 5.
+ *
+ */
+#define MOVEGEN_ROWS_ABOVE      8
+
+/**
+ * @brief A final placement of a simulation's falling piece, i.e. a position and rotation where it would lock.
+ *
+ * @field x The piece's X coordinate (see piece_position).
+ * @field rotation The piece's rotation.
+ * @field y The piece's Y coordinate (see piece_position).
+ *
+ */
+struct placement {
+    int8_t x;
+    uint8_t rotation;
+    int16_t y;
+};
+
+/**
+ * @brief Upper bound on the number of distinct placements of a piece on the largest playing field that fits a bitboard row type.
+ *
+ * @tparam row_t The bitboard row type.
+ * @field capacity The maximum number of placements.
+ *
+ */
+template<typename row_t>
+struct placement_limits {
+    static constexpr int capacity = 4 * (field_traits<row_t>::max_height + MOVEGEN_ROWS_ABOVE) * field_traits<row_t>::max_width;
+};
+
+/**
+ * @brief Fixed-capacity list of placements, filled in by generate_placements() without any heap allocation. Note that the list is sized for the largest playing field of its row type, which is around 10 KB for 16-bit rows but over 500 KB for 64-bit rows; lists for the larger row types shouldn't be kept on the stack.
+ *
+ * @tparam row_t The bitboard row type of the simulations that the placements are generated for.
+ * @field placements The placements.
+ * @field count The number of placements in the list.
+ *
+ */
+template<typename row_t>
+struct basic_placement_list {
+    placement placements[placement_limits<row_t>::capacity];
+    int count;
+};
+
+/**
+ * @brief Placement list for the default playing field size.
+ *
+ */
+typedef basic_placement_list<uint16_t> placement_list;
+
+/**
+ * @brief Generate every distinct final placement of a simulation's falling piece that can be reached from where it is by left, right and down moves and rotations, following the same collision and wall kick rules as handle_left_move(), handle_right_move(), handle_down_move() and handle_rotate().
+ *
+ * The search is a flood fill over bitboard rows: for each rotation and Y coordinate, the set of X coordinates that the piece fits at and the set it can reach are kept as bit masks, so that a whole row of positions is moved, rotated and tested at once. Placements that occupy the same cells (e.g. the rotations of the O piece, or the two pairs of rotations of the I, S and Z pieces) are only listed once, with the first rotation that produces them.
+ *
+ * @param sim The simulation data structure.
+ * @param list The list to fill in. Placements are listed by rotation, then Y coordinate, then X coordinate, so the order only depends on the simulation's state.
+ * @return int The number of placements, which is 0 after game over.
+ */
+template<typename row_t>
+int generate_placements(const basic_sim_data<row_t> &sim, basic_placement_list<row_t> &list);
+
+/**
+ * @brief Get the falling piece of a simulation moved to a placement.
+ *
+ * @param sim The simulation data structure.
+ * @param target The placement.
+ * @return piece The falling piece at the placement.
+ */
+template<typename row_t>
+inline piece placement_piece(const basic_sim_data<row_t> &sim, const placement &target) {
+    piece result = sim.next_pieces[0];
+    result.rotation = target.rotation;
+    result.position.x = target.x; result.position.y = target.y;
+    return result;
+}
+
+/**
+ * @brief Move a simulation's falling piece to a placement and lock it there; see settle_piece().
+ *
+ * @param sim The simulation data structure.
+ * @param target The placement, as returned by generate_placements() for the simulation's current state.
+ */
+template<typename row_t>
+void apply_placement(basic_sim_data<row_t> &sim, const placement &target);
+
+#endif
@@ -0,0 +1,102 @@
+#include "perft.h"
+#include "movegen.h"
+#include "utils.h"
+#include "splashkit.h"
+
+using namespace std;
+
+/* count placement sequences */
+uint64_t perft(const sim_data &sim, int depth, transposition_table *table) {
+    if(depth == 0) return 1;
+
+    placement_list list;
+    int count = generate_placements(sim, list);
+    if(depth == 1) return count; // no need to play out the last placements to count them
+
+    /* look for a transposition */
+    uint64_t key = zobrist_key(sim) ^ (uint64_t)depth * 0x9E3779B97F4A7C15ULL; // the same state at another depth has another count
+    tt_data entry;
+    if(table && tt_probe(*table, key, entry) && entry.depth == depth) return (uint64_t)entry.value;
+
+    uint64_t result = 0;
+    sim_data child;
+    for(int i = 0; i < count; i++) {
+        copy_sim(child, sim);
+        apply_placement(child, list.placements[i]);
+        result += perft(child, depth - 1, table);
+    }
+
+    if(table) {
+        entry.value = (int64_t)result; entry.depth = (uint8_t)depth;
+        tt_store(*table, key, entry);
+    }
+    return result;
+}
+
+/* collect the states after the given number of placements */
+static void expand_perft(const sim_data &sim, int depth, vector<sim_data> &frontier) {
+    if(depth == 0) {
+        frontier.push_back(sim);
+        return;
+    }
+
+    placement_list list;
+    int count = generate_placements(sim, list);
+    sim_data child;
+    for(int i = 0; i < count; i++) {
+        copy_sim(child, sim);
+        apply_placement(child, list.placements[i]);
+        expand_perft(child, depth - 1, frontier);
+    }
+}
+
+/* count placement sequences in parallel */
+perft_result run_perft(thread_pool &pool, const sim_data &sim, int depth, transposition_table *table) {
+    auto start = chrono::steady_clock::now();
+    if(table) clear_tt(*table);
+
+    /* expand the first plies here, then count each subtree on the pool; the last ply is always left for perft() to count in bulk */
+    int split = MIN(PERFT_SPLIT_DEPTH, MAX(depth - 1, 0));
+    vector<sim_data> frontier;
+    expand_perft(sim, split, frontier);
+
+    atomic<uint64_t> nodes(0);
+    pool_parallel_for(pool, frontier.size(), 1, [&frontier, &nodes, depth, split, table](size_t begin, size_t end) {
+        uint64_t n = 0;
+        for(size_t i = begin; i < end; i++) n += perft(frontier[i], depth - split, table);
+        nodes += n;
+    });
+
+    perft_result result;
+    result.nodes = nodes;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/* run perft from the command line */
+int perft_main(int argc, char *argv[]) {
+    uint64_t seed = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 0;
+    int depth = (argc > 3) ? atoi(argv[3]) : 3;
+    int threads = (argc > 4) ? atoi(argv[4]) : 0;
+    int level = (argc > 5) ? atoi(argv[5]) : 0;
+    size_t hash_mb = (argc > 6) ? strtoull(argv[6], nullptr, 10) : 0;
+    if(depth < 1) {
+        write_line("Usage: " + string(argv[0]) + " --perft [seed] [depth] [threads] [level] [hash table size (MB, 0 for none)]");
+        return 1;
+    }
+
+    thread_pool pool;
+    start_thread_pool(pool, threads);
+    transposition_table table;
+    if(hash_mb) resize_tt(table, hash_mb);
+    write_line("Seed: " + to_string(seed) + ", threads: " + to_string(pool_threads(pool)) + ", hash table: " + ((hash_mb) ? (to_string(hash_mb) + " MB") : string("none")));
+
+    sim_data sim = new_sim(level, seed);
+    for(int d = 1; d <= depth; d++) {
+        perft_result result = run_perft(pool, sim, d, (hash_mb) ? &table : nullptr);
+        write_line("Depth " + to_string(d) + ": " + to_string(result.nodes) + " nodes, " + to_string(result.seconds) + " s, " + to_string((long long)(result.nodes / MAX(result.seconds, 1e-9))) + " nodes/s");
+    }
+
+    stop_thread_pool(pool);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "sim.h"
+#include "thread_pool.h"
+#include "zobrist.h"
+
+using namespace std;
+
+/**
+ * @brief The number of plies that run_perft() expands on the calling thread before handing the subtrees out to the thread pool. Two plies make several hundred subtrees, which is plenty to keep every worker busy.
+ *
+ */
+#define PERFT_SPLIT_DEPTH       2
+
+/**
+ * @brief Perft results.
+ *
+ * @field nodes The number of distinct placement sequences of the requested length.
+ * @field seconds The wall clock time taken to count them.
+ *
+ */
+struct perft_result {
+    uint64_t nodes;
+    double seconds;
+};
+
+/**
+ * @brief Count the distinct sequences of placements of the given length that can be played from a simulation's state (perft, as in chess engines), by generating every placement (see generate_placements()) and locking the piece there (see apply_placement()) recursively. Sequences that end in a game over before reaching the given length aren't counted.
+ *
+ * Since the count only depends on the placement generator and the playing field rules, it changes whenever they do, which makes it a handy regression check.
+ *
+ * @param sim The simulation data structure.
+ * @param depth The sequences' length (in placements).
+ * @param table Optional transposition table, for counting the subtrees of states that are reached more than once (e.g. when different placements clear rows into the same playing field) only once. Its entries are keyed by the states' Zobrist keys and depths only, so it must be cleared before searching from another state.
+ * @return uint64_t The number of sequences.
+ */
+uint64_t perft(const sim_data &sim, int depth, transposition_table *table = nullptr);
+
+/**
+ * @brief Count placement sequences like perft(), splitting the search tree over a thread pool.
+ *
+ * @param pool The thread pool to run the search on.
+ * @param sim The simulation data structure.
+ * @param depth The sequences' length (in placements).
+ * @param table Optional transposition table, shared by all threads; see perft(). It's cleared before the search.
+ * @return perft_result The results.
+ */
+perft_result run_perft(thread_pool &pool, const sim_data &sim, int depth, transposition_table *table = nullptr);
+
+/**
+ * @brief Run perft from the command line for each depth up to the given one, and print the node counts and rates. Usage: --perft [seed] [depth] [threads] [level] [hash table size (MB, 0 for none)]
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return int The program's return value.
+ */
+int perft_main(int argc, char *argv[]);
+
+#endif
@@ -15,54 +15,62 @@ using namespace std;
  */
 #define FIELD_DRAW_Y            (FIELD_Y + FIELD_BORDER_WIDTH)
 
+/* create an empty piece bag */
+piece_bag new_bag() {
+    piece_bag result;
+    for(int i = 0; i < 7; i++) result.types[i] = i;
+    result.next = 7; // empty, so that the first draw shuffles it
+    return result;
+}
+
+/* deal a piece type from the bag */
+int bag_draw(piece_bag &bag, rng_state &rng) {
+    if(bag.next >= 7) {
+        /* refill the bag with a Fisher-Yates shuffle of its contents (which are always a permutation of the 7 types) */
+        for(int i = 6; i > 0; i--) {
+            int j = rng_range(rng, 0, i);
+            uint8_t t = bag.types[i]; bag.types[i] = bag.types[j]; bag.types[j] = t;
+        }
+        bag.next = 0;
+    }
+
+    return bag.types[bag.next++];
+}
+
 /* (re)position a piece */
-void position_piece(piece &p) {
-    p.position.y = -(p.type->bitmaps[p.rotation].height + p.type->bitmaps[p.rotation].y);
-    p.position.x = rnd(-p.type->bitmaps[p.rotation].x, FIELD_WIDTH - (p.type->bitmaps[p.rotation].x + p.type->bitmaps[p.rotation].width));
+void position_piece(piece &p, rng_state &rng, int field_width) {
+    p.position.y = -(piece_types[p.type].bitmaps[p.rotation].height + piece_types[p.type].bitmaps[p.rotation].y);
+    p.position.x = rng_range(rng, -piece_types[p.type].bitmaps[p.rotation].x, field_width - (piece_types[p.type].bitmaps[p.rotation].x + piece_types[p.type].bitmaps[p.rotation].width));
 }
 
 /* generate a new random piece */
-piece new_piece() {
+piece new_piece(piece_bag &bag, rng_state &rng, int field_width) {
     piece result;
     
-    result.type = &piece_types[rnd(6)]; // see piece_types.cpp
-    result.rotation = rnd(3); // there are 4 possible rotated variants for each piece, also see piece_types.cpp
+    result.type = bag_draw(bag, rng); // see piece_types.cpp
+    result.rotation = rng_range(rng, 0, 3); // there are 4 possible rotated variants for each piece, also see piece_types.cpp
     
-    position_piece(result);
+    position_piece(result, rng, field_width);
 
     return result;
 }
 
-/* generate one or more pieces and append them to the pieces double-ended queue (deque), ensuring that each piece's type are unique */
-void new_pieces(deque<piece> &pieces, int n) {
-    do {
-        piece result = new_piece(); // generate a piece
-
-        /* check for duplication */
-        bool duplicate = false;
-        for(int i = 0; i < pieces.size(); i++) {
-            if(pieces[i].type->p_color == result.type->p_color) {
-                duplicate = true;
-                break;
-            }
-        }
-
-        if(!duplicate) {
-            /* append to vector if it's not unique */
-            pieces.push_back(result);
-            n--;
-        }
-    } while(n > 0);
+/* pop the front piece and append a new one to the end of the queue */
+void queue_push(piece_queue &pieces, const piece &p) {
+    pieces.pieces[pieces.head] = p; // the front piece's slot becomes the back of the queue
+    pieces.head = (pieces.head + 1) % NEXT_PIECES_CNT;
 }
 
-deque<piece> new_pieces(int n) {
-    deque<piece> result;
-    new_pieces(result, n);
+/* generate a full queue of new pieces */
+piece_queue new_pieces(piece_bag &bag, rng_state &rng, int field_width) {
+    piece_queue result;
+    for(int i = 0; i < NEXT_PIECES_CNT; i++) result.pieces[i] = new_piece(bag, rng, field_width);
+    result.head = 0;
     return result;
 }
 
 /* draw a cell, given its colour and position, and (optionally) whether the position is absolute */
-void draw_cell(piece_colour p_color, const piece_position &position, bool absolute) {
+void draw_cell(piece_colour p_color, const piece_position &position, bool absolute, bool ghost) {
     /* resolve piece colour */
     color draw_color;
     switch(p_color) {
@@ -104,6 +112,10 @@ void draw_cell(piece_colour p_color, const piece_position &position, bool absolu
     // write_line("Colour: " + color_to_string(draw_color) + ", x = " + to_string(x) + ", y = " + to_string(y));
 
     /* draw the cell itself */
+    if(ghost) {
+        draw_rectangle(draw_color, x + PIECE_PADDING, y + PIECE_PADDING, PIECE_SIZE - 2 * PIECE_PADDING, PIECE_SIZE - 2 * PIECE_PADDING, option_line_width(PIECE_BORDER_WIDTH)); // outline only
+        return;
+    }
     fill_rectangle(draw_color, x, y, PIECE_SIZE, PIECE_SIZE);
     draw_rectangle(PIECE_BORDER_COLOR, x + PIECE_PADDING, y + PIECE_PADDING, PIECE_SIZE - 2 * PIECE_PADDING, PIECE_SIZE - 2 * PIECE_PADDING, option_line_width(PIECE_BORDER_WIDTH));
 }
@@ -112,8 +124,18 @@ void draw_cell(piece_colour p_color, const piece_position &position, bool absolu
 void draw_piece(const piece &p) {
     for(int y = 0; y < 4 && p.position.y + y < FIELD_HEIGHT; y++) {
         for(int x = 0; x < 4 && p.position.x + x < FIELD_WIDTH; x++) {
-            if(p.type->bitmaps[p.rotation].bitmap & (1 << (y * 4 + x)))
-                draw_cell(p.type->p_color, {(p.position.x + x), (p.position.y + y)});
+            if(piece_types[p.type].bitmaps[p.rotation].bitmap & (1 << (y * 4 + x)))
+                draw_cell(piece_types[p.type].p_color, {(p.position.x + x), (p.position.y + y)});
+        }
+    }
+}
+
+/* draw a piece's ghost, i.e. its outline */
+void draw_ghost_piece(const piece &p) {
+    for(int y = 0; y < 4 && p.position.y + y < FIELD_HEIGHT; y++) {
+        for(int x = 0; x < 4 && p.position.x + x < FIELD_WIDTH; x++) {
+            if(piece_types[p.type].bitmaps[p.rotation].bitmap & (1 << (y * 4 + x)))
+                draw_cell(piece_types[p.type].p_color, {(p.position.x + x), (p.position.y + y)}, false, true);
         }
     }
 }
@@ -124,14 +146,14 @@ void draw_piece(const piece &p, const piece_position &position, bool absolute, b
 
     int d = (absolute) ? PIECE_TOTAL_SIZE : 1; // cell_x/y increment step
 
-    int y0 = (tight) ? p.type->bitmaps[p.rotation].y : 0;
-    for(int y = y0; y - y0 < ((tight) ? p.type->bitmaps[p.rotation].height : 4) && (absolute || (cell_y < FIELD_HEIGHT)); y++, cell_y += d) {
+    int y0 = (tight) ? piece_types[p.type].bitmaps[p.rotation].y : 0;
+    for(int y = y0; y - y0 < ((tight) ? piece_types[p.type].bitmaps[p.rotation].height : 4) && (absolute || (cell_y < FIELD_HEIGHT)); y++, cell_y += d) {
         int cell_x = position.x;
 
-        int x0 = (tight) ? p.type->bitmaps[p.rotation].x : 0;
-        for(int x = x0; x - x0 < ((tight) ? p.type->bitmaps[p.rotation].width : 4) && (absolute || (cell_x < FIELD_WIDTH)); x++, cell_x += d) {
-            if(p.type->bitmaps[p.rotation].bitmap & (1 << (y * 4 + x))) {
-                draw_cell(p.type->p_color, {cell_x, cell_y}, absolute);
+        int x0 = (tight) ? piece_types[p.type].bitmaps[p.rotation].x : 0;
+        for(int x = x0; x - x0 < ((tight) ? piece_types[p.type].bitmaps[p.rotation].width : 4) && (absolute || (cell_x < FIELD_WIDTH)); x++, cell_x += d) {
+            if(piece_types[p.type].bitmaps[p.rotation].bitmap & (1 << (y * 4 + x))) {
+                draw_cell(piece_types[p.type].p_color, {cell_x, cell_y}, absolute);
             }
         }
     }
@@ -141,8 +163,8 @@ void draw_piece(const piece &p, const piece_position &position, bool absolute, b
 piece_position piece_centre_point(const piece &p, bool offset) {
     piece_position result;
 
-    result.x = ((offset) ? 0 : p.position.x) + p.type->bitmaps[p.rotation].x + p.type->bitmaps[p.rotation].width / 2;
-    result.y = ((offset) ? 0 : p.position.y) + p.type->bitmaps[p.rotation].y + p.type->bitmaps[p.rotation].height / 2;
+    result.x = ((offset) ? 0 : p.position.x) + piece_types[p.type].bitmaps[p.rotation].x + piece_types[p.type].bitmaps[p.rotation].width / 2;
+    result.y = ((offset) ? 0 : p.position.y) + piece_types[p.type].bitmaps[p.rotation].y + piece_types[p.type].bitmaps[p.rotation].height / 2;
 
     return result;
 }
@@ -150,7 +172,7 @@ piece_position piece_centre_point(const piece &p, bool offset) {
 /* FOR DEBUGGING - get a descriptive string of a piece */
 string piece_to_string(const piece &p) {
     string type = "Unknown";
-    switch(p.type->p_color) {
+    switch(piece_types[p.type].p_color) {
         case CYAN: type = "I"; break;
         case BLUE: type = "J"; break;
         case ORANGE: type = "L"; break;
@@ -2,7 +2,8 @@
 #define PIECE_H
 
 #include "splashkit.h"
-#include <deque>
+#include "config.h"
+#include "rng.h"
 
 using namespace std;
 
@@ -78,14 +79,14 @@ struct piece_position {
 /**
  * @brief Piece information.
  * 
- * @field type Pointer to the piece's type information structure.
+ * @field type The piece's type index into piece_types. This is an index rather than a pointer so that game states hash and compare the same across runs.
  * @field rotation The piece's rotated variant index (0 to 3).
  * @field position The piece bitmap's position in the playing field.
  * 
  */
 struct piece {
-    const piece_type *type;
-    int rotation;
+    uint8_t type;
+    uint8_t rotation;
     piece_position position;
 };
 
@@ -96,34 +97,246 @@ struct piece {
 extern const piece_type piece_types[7]; // NOTE: extern is used so that g++ wouldn't complain
 
 /**
- * @brief Position (or reposition) a piece to the top of the playing field.
+ * @brief The lowest piece X position covered by the piece masks tables. Pieces any further to the left have no cells within a bitboard row.
+ * 
+ */
+#define PIECE_MASK_X_MIN        (-4)
+
+/**
+ * @brief A piece bitmap's rows, already shifted to a given X position in a playing field bitboard.
+ * 
+ * @tparam row_t The bitboard row type (uint16_t, uint32_t or uint64_t).
+ * @field rows The bitboard row masks for each of the bitmap's 4 rows. Cells shifted past either side of the bitboard row are dropped.
+ * 
+ */
+template<typename row_t>
+struct piece_mask {
+    row_t rows[4];
+};
+
+/**
+ * @brief Table of precomputed piece masks for every piece type, rotation and X position, generated at compile time from piece_types.
+ * 
+ * @tparam row_t The bitboard row type (uint16_t, uint32_t or uint64_t).
+ * @field x_max The highest piece X position covered by the table. Pieces any further to the right have no cells within a bitboard row.
+ * @field x_cnt The number of piece X positions covered by the table.
+ * @field masks The piece masks, indexed by piece type, rotation and X position (offset by PIECE_MASK_X_MIN).
+ * 
+ */
+template<typename row_t>
+struct piece_mask_table {
+    static constexpr int x_max = sizeof(row_t) * 8;
+    static constexpr int x_cnt = x_max - PIECE_MASK_X_MIN + 1;
+
+    piece_mask<row_t> masks[7][4][x_cnt];
+};
+
+/**
+ * @brief The piece masks table for 16-bit bitboard rows.
+ * 
+ */
+extern const piece_mask_table<uint16_t> piece_masks_16;
+
+/**
+ * @brief The piece masks table for 32-bit bitboard rows.
+ * 
+ */
+extern const piece_mask_table<uint32_t> piece_masks_32;
+
+/**
+ * @brief The piece masks table for 64-bit bitboard rows.
+ * 
+ */
+extern const piece_mask_table<uint64_t> piece_masks_64;
+
+/**
+ * @brief Get the piece masks table for a bitboard row type.
+ * 
+ * @tparam row_t The bitboard row type (uint16_t, uint32_t or uint64_t).
+ * @return const piece_mask_table<row_t>& The piece masks table.
+ */
+template<typename row_t> const piece_mask_table<row_t> &piece_masks();
+template<> inline const piece_mask_table<uint16_t> &piece_masks<uint16_t>() { return piece_masks_16; }
+template<> inline const piece_mask_table<uint32_t> &piece_masks<uint32_t>() { return piece_masks_32; }
+template<> inline const piece_mask_table<uint64_t> &piece_masks<uint64_t>() { return piece_masks_64; }
+
+/**
+ * @brief Look up a piece's precomputed bitboard row masks.
+ * 
+ * @tparam row_t The bitboard row type (uint16_t, uint32_t or uint64_t).
+ * @param type The piece's type index into piece_types.
+ * @param rotation The piece's rotated variant index (0 to 3).
+ * @param x The piece's X position in the playing field.
+ * @return const piece_mask<row_t>& The piece's row masks at the given X position.
+ */
+template<typename row_t>
+inline const piece_mask<row_t> &piece_mask_at(int type, int rotation, int x) {
+    const int x_max = piece_mask_table<row_t>::x_max;
+    x = (x < PIECE_MASK_X_MIN) ? PIECE_MASK_X_MIN : ((x > x_max) ? x_max : x); // positions outside the table have the same (empty) masks as the ends of the table
+    return piece_masks<row_t>().masks[type][rotation][x - PIECE_MASK_X_MIN];
+}
+
+/**
+ * @brief Look up a piece's precomputed bitboard row masks at its current position.
+ * 
+ * @tparam row_t The bitboard row type (uint16_t, uint32_t or uint64_t).
+ * @param p The piece.
+ * @return const piece_mask<row_t>& The piece's row masks.
+ */
+template<typename row_t>
+inline const piece_mask<row_t> &piece_mask_at(const piece &p) {
+    return piece_mask_at<row_t>(p.type, p.rotation, p.position.x);
+}
+
+/**
+ * @brief A piece bitmap's column profile: the topmost and bottommost cells in each of its columns.
+ * 
+ * @field tops The bitmap row of the topmost cell in each bitmap column, or -1 if the column is empty.
+ * @field bottoms The bitmap row of the bottommost cell in each bitmap column, or -1 if the column is empty.
+ * 
+ */
+struct piece_profile {
+    int8_t tops[4];
+    int8_t bottoms[4];
+};
+
+/**
+ * @brief Table of column profiles for every piece type and rotation, generated at compile time from piece_types.
+ * 
+ * @field profiles The column profiles, indexed by piece type and rotation.
+ * 
+ */
+struct piece_profile_table {
+    piece_profile profiles[7][4];
+};
+
+/**
+ * @brief The piece column profiles table.
+ * 
+ */
+extern const piece_profile_table piece_profiles;
+
+/**
+ * @brief Look up a piece's column profile.
+ * 
+ * @param p The piece.
+ * @return const piece_profile& The piece's column profile.
+ */
+inline const piece_profile &piece_profile_of(const piece &p) {
+    return piece_profiles.profiles[p.type][p.rotation];
+}
+
+/**
+ * @brief A piece bitmap's shape: the list of its cells, and the first rotation of the same piece with the same shape.
+ * 
+ * @field cell_x The cells' X coordinates, relative to the left edge of the bitmap's bounding box.
+ * @field cell_y The cells' Y coordinates, relative to the top of the bitmap.
+ * @field canon The first rotation of the same piece type that occupies the same cells when its bounding box is in the same place (e.g. rotation 0 for all of the O piece's rotations).
+ * 
+ */
+struct piece_shape {
+    int8_t cell_x[4];
+    int8_t cell_y[4];
+    uint8_t canon;
+};
+
+/**
+ * @brief Table of shapes for every piece type and rotation, generated at compile time from piece_types.
+ * 
+ * @field shapes The shapes, indexed by piece type and rotation.
+ * 
+ */
+struct piece_shape_table {
+    piece_shape shapes[7][4];
+};
+
+/**
+ * @brief The piece shapes table.
+ * 
+ */
+extern const piece_shape_table piece_shapes;
+
+/**
+ * @brief Piece bag for the 7-bag randomizer: each of the 7 piece types is dealt once, in a random order, before the bag is refilled.
+ * 
+ * @field types The piece type indices (into piece_types) in the bag, in the order they will be dealt.
+ * @field next The index of the next piece type to be dealt; the bag is empty (and will be refilled on the next draw) when this reaches 7.
+ * 
+ */
+struct piece_bag {
+    uint8_t types[7];
+    uint8_t next;
+};
+
+/**
+ * @brief Create an empty piece bag, which will be filled on its first draw.
+ * 
+ * @return piece_bag The resulting piece bag.
+ */
+piece_bag new_bag();
+
+/**
+ * @brief Deal the next piece type out of a piece bag, refilling and shuffling the bag if it's empty.
+ * 
+ * @param bag The piece bag.
+ * @param rng The pseudorandom number generator used to shuffle the bag.
+ * @return int The dealt piece type's index into piece_types.
+ */
+int bag_draw(piece_bag &bag, rng_state &rng);
+
+/**
+ * @brief Position (or reposition) a piece to the top of the playing field, at a random column.
  * 
  * @param p The piece to be (re)positioned.
+ * @param rng The pseudorandom number generator used to pick the column.
+ * @param field_width The playing field's width (in cells).
  */
-void position_piece(piece &p);
+void position_piece(piece &p, rng_state &rng, int field_width = FIELD_WIDTH);
 
 /**
  * @brief Generate a random piece and place it right above the playing field for descent.
  * 
+ * @param bag The piece bag to deal the piece's type from.
+ * @param rng The pseudorandom number generator used to pick the piece's rotation and column.
+ * @param field_width The playing field's width (in cells).
  * @return piece The resulting piece.
  */
-piece new_piece();
+piece new_piece(piece_bag &bag, rng_state &rng, int field_width = FIELD_WIDTH);
 
 /**
- * @brief Generate one or more new pieces and add them to a double-ended queue (deque), ensuring that all pieces in the queue are unique.
+ * @brief Fixed-capacity ring buffer holding the falling piece followed by the next pieces. This is always full (NEXT_PIECES_CNT pieces), and is stored inline so that it can be copied along with the rest of a game's state.
+ * 
+ * @field pieces The pieces' storage; use the subscript operator to access them in queue order.
+ * @field head The storage index of the front (i.e. falling) piece.
+ * 
+ */
+struct piece_queue {
+    piece pieces[NEXT_PIECES_CNT];
+    uint8_t head;
+
+    piece &operator[](int i) { return pieces[(head + i) % NEXT_PIECES_CNT]; }
+    const piece &operator[](int i) const { return pieces[(head + i) % NEXT_PIECES_CNT]; }
+};
+
+static_assert(NEXT_PIECES_CNT >= 2, "the next pieces queue must hold at least the falling piece and the piece to swap with");
+
+/**
+ * @brief Pop the front piece off a pieces queue and append another piece to its end.
  * 
  * @param pieces The pieces queue to operate on.
- * @param n The number of new pieces to add.
+ * @param p The piece to be appended.
  */
-void new_pieces(deque<piece> &pieces, int n);
+void queue_push(piece_queue &pieces, const piece &p);
 
 /**
- * @brief Generate a double-ended queue (deque) of new pieces.
+ * @brief Generate a full queue of new pieces.
  * 
- * @param n The number of new pieces.
- * @return deque<piece> The resulting queue.
+ * @param bag The piece bag to deal the pieces' types from.
+ * @param rng The pseudorandom number generator used to pick the pieces' rotations and columns.
+ * @param field_width The playing field's width (in cells).
+ * @return piece_queue The resulting queue.
  */
-deque<piece> new_pieces(int n);
+piece_queue new_pieces(piece_bag &bag, rng_state &rng, int field_width = FIELD_WIDTH);
 
 /**
  * @brief Draw a cell on the game window.
@@ -131,8 +344,9 @@ deque<piece> new_pieces(int n);
  * @param color The cell's colour.
  * @param position The cell's position within the playing field, or on the screen (in pixels); this is dictated by the absolute parameter.
  * @param absolute Drawing mode (absolute or relative); when this is set, the function will treat position as the cell's screen position in pixels.
+ * @param ghost Ghost drawing mode; when this is set, only the cell's outline is drawn.
  */
-void draw_cell(piece_colour color, const piece_position &position, bool absolute = false);
+void draw_cell(piece_colour color, const piece_position &position, bool absolute = false, bool ghost = false);
 
 /**
  * @brief Draw a piece on the screen using its internally-stored position on the playing field.
@@ -141,6 +355,13 @@ void draw_cell(piece_colour color, const piece_position &position, bool absolute
  */
 void draw_piece(const piece &p);
 
+/**
+ * @brief Draw a piece's ghost (i.e. its outline) on the screen using its internally-stored position on the playing field. This is used to show where the falling piece would land.
+ * 
+ * @param p The piece to be drawn.
+ */
+void draw_ghost_piece(const piece &p);
+
 /**
  * @brief Draw a piece on the screen using an externally provided (optionally absolute; see draw_cell()) position, and optionally draw it tightly.
  * 
@@ -1,7 +1,7 @@
 #include "piece.h"
 
 /* list of piece types for copying into new pieces */
-const piece_type piece_types[7] = {
+constexpr piece_type piece_types[7] = {
     {
         // I piece
         CYAN,
@@ -325,3 +325,157 @@ const piece_type piece_types[7] = {
         }
     }
 };
+
+/* generate a piece masks table from piece_types */
+template<typename row_t>
+static constexpr piece_mask_table<row_t> make_piece_masks() {
+    piece_mask_table<row_t> result = {};
+
+    for(int t = 0; t < 7; t++) {
+        for(int r = 0; r < 4; r++) {
+            for(int x = PIECE_MASK_X_MIN; x <= piece_mask_table<row_t>::x_max; x++) {
+                for(int y = 0; y < 4; y++) {
+                    row_t row = PIECE_ROW(piece_types[t].bitmaps[r].bitmap, y);
+                    result.masks[t][r][x - PIECE_MASK_X_MIN].rows[y] = (x >= piece_mask_table<row_t>::x_max) ? 0 : ((x >= 0) ? (row_t)(row << x) : (row_t)(row >> -x));
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+constexpr piece_mask_table<uint16_t> piece_masks_16 = make_piece_masks<uint16_t>();
+constexpr piece_mask_table<uint32_t> piece_masks_32 = make_piece_masks<uint32_t>();
+constexpr piece_mask_table<uint64_t> piece_masks_64 = make_piece_masks<uint64_t>();
+
+/* generate the column profiles table from piece_types */
+static constexpr piece_profile_table make_piece_profiles() {
+    piece_profile_table result = {};
+
+    for(int t = 0; t < 7; t++) {
+        for(int r = 0; r < 4; r++) {
+            piece_profile &profile = result.profiles[t][r];
+            for(int x = 0; x < 4; x++) {
+                profile.tops[x] = -1; profile.bottoms[x] = -1;
+                for(int y = 0; y < 4; y++) {
+                    if(piece_types[t].bitmaps[r].bitmap & (1 << (y * 4 + x))) {
+                        if(profile.tops[x] < 0) profile.tops[x] = y;
+                        profile.bottoms[x] = y;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+constexpr piece_profile_table piece_profiles = make_piece_profiles();
+
+/* get a bitmap moved to its top left corner */
+static constexpr uint16_t normalized_bitmap(const piece_bitmap &bitmap) {
+    uint16_t result = 0;
+    for(int y = bitmap.y; y < 4; y++) {
+        for(int x = bitmap.x; x < 4; x++) {
+            if(bitmap.bitmap & (1 << (y * 4 + x))) result |= 1 << ((y - bitmap.y) * 4 + (x - bitmap.x));
+        }
+    }
+    return result;
+}
+
+/* generate the shapes table from piece_types; every piece has exactly 4 cells, as verify_piece_types() asserts */
+static constexpr piece_shape_table make_piece_shapes() {
+    piece_shape_table result = {};
+
+    for(int t = 0; t < 7; t++) {
+        for(int r = 0; r < 4; r++) {
+            const piece_bitmap &bitmap = piece_types[t].bitmaps[r];
+            piece_shape &shape = result.shapes[t][r];
+
+            int n = 0;
+            for(int y = 0; y < 4; y++) {
+                for(int x = 0; x < 4; x++) {
+                    if((bitmap.bitmap & (1 << (y * 4 + x))) && n < 4) {
+                        shape.cell_x[n] = x - bitmap.x; shape.cell_y[n] = y;
+                        n++;
+                    }
+                }
+            }
+
+            shape.canon = r;
+            for(int c = r - 1; c >= 0; c--) {
+                if(normalized_bitmap(piece_types[t].bitmaps[c]) == normalized_bitmap(bitmap)) shape.canon = c;
+            }
+        }
+    }
+
+    return result;
+}
+
+constexpr piece_shape_table piece_shapes = make_piece_shapes();
+
+/* verify the bounding boxes in piece_types */
+static constexpr bool verify_piece_types() {
+    for(int t = 0; t < 7; t++) {
+        for(int r = 0; r < 4; r++) {
+            const piece_bitmap &bitmap = piece_types[t].bitmaps[r];
+
+            /* every piece has 4 cells, all of which are inside its bounding box, which is in turn inside the bitmap */
+            int cells = 0;
+            if(bitmap.x + bitmap.width > 4 || bitmap.y + bitmap.height > 4) return false;
+            for(int y = 0; y < 4; y++) {
+                for(int x = 0; x < 4; x++) {
+                    if(bitmap.bitmap & (1 << (y * 4 + x))) {
+                        if(x < bitmap.x || x >= bitmap.x + bitmap.width || y < bitmap.y || y >= bitmap.y + bitmap.height) return false;
+                        cells++;
+                    }
+                }
+            }
+            if(cells != 4) return false;
+
+            /* the bounding box is tight, i.e. its edges all have cells on them */
+            if(!(PIECE_ROW(bitmap.bitmap, bitmap.y)) || !(PIECE_ROW(bitmap.bitmap, bitmap.y + bitmap.height - 1))) return false;
+            if(!(PIECE_COL(bitmap.bitmap, bitmap.x)) || !(PIECE_COL(bitmap.bitmap, bitmap.x + bitmap.width - 1))) return false;
+        }
+    }
+
+    return true;
+}
+
+static_assert(verify_piece_types(), "piece_types has malformed bounding boxes");
+
+/* verify a piece masks table cell by cell */
+template<typename row_t>
+static constexpr bool verify_piece_masks(const piece_mask_table<row_t> &table) {
+    const int x_max = piece_mask_table<row_t>::x_max;
+
+    for(int t = 0; t < 7; t++) {
+        for(int r = 0; r < 4; r++) {
+            const piece_bitmap &bitmap = piece_types[t].bitmaps[r];
+
+            /* each mask bit is set if and only if the corresponding cell is */
+            for(int x = PIECE_MASK_X_MIN; x <= x_max; x++) {
+                const piece_mask<row_t> &mask = table.masks[t][r][x - PIECE_MASK_X_MIN];
+                for(int y = 0; y < 4; y++) {
+                    for(int field_x = 0; field_x < x_max; field_x++) {
+                        int cell_x = field_x - x;
+                        bool cell = (cell_x >= 0 && cell_x < 4 && (bitmap.bitmap & (1 << (y * 4 + cell_x))));
+                        if(cell != ((mask.rows[y] & ((row_t)1 << field_x)) != 0)) return false;
+                    }
+                }
+            }
+
+            /* the ends of the table must be empty, since piece_mask_at() clamps positions outside of it to them */
+            for(int y = 0; y < 4; y++) {
+                if(table.masks[t][r][0].rows[y] || table.masks[t][r][x_max - PIECE_MASK_X_MIN].rows[y]) return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static_assert(verify_piece_masks(piece_masks_16), "16-bit piece masks table does not match piece_types");
+static_assert(verify_piece_masks(piece_masks_32), "32-bit piece masks table does not match piece_types");
+static_assert(verify_piece_masks(piece_masks_64), "64-bit piece masks table does not match piece_types");
@@ -0,0 +1,405 @@
+#include "replay.h"
+#include "snapshot.h"
+#include "utils.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static_assert(ACTION_HARD_DROP < (1 << REPLAY_ACTION_BITS), "every action must fit in a replay run's action bits");
+
+/**
+ * @brief A position in a replay's runs, as reached by playing it.
+ *
+ * @field run The run that the next frame is in.
+ * @field skip The number of that run's frames that have already been played.
+ * @field frame The number of frames played so far.
+ * @field keyframe The next keyframe to check the playback against.
+ *
+ */
+struct replay_cursor {
+    const uint8_t *run;
+    uint64_t skip;
+    uint64_t frame;
+    uint32_t keyframe;
+};
+
+/* append a little endian integer */
+static void put_uint(vector<uint8_t> &data, uint64_t value, int bytes) {
+    data.resize(data.size() + bytes);
+    store_le(&data[data.size() - bytes], value, bytes);
+}
+
+/* append a varint */
+static void put_varint(vector<uint8_t> &data, uint64_t value) {
+    while(value >= 0x80) {
+        data.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back((uint8_t)value);
+}
+
+/* read a varint, advancing the read position past it */
+static bool get_varint(const uint8_t *&data, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for(int shift = 0; data < end && shift < 64; shift += 7) {
+        uint8_t byte = *data++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false; // truncated or overlong
+}
+
+/* read a run, advancing the read position past it; the end marker reads as a run of no frames */
+static bool read_run(const replay_view &view, const uint8_t *&pos, replay_run &run) {
+    uint64_t value;
+    if(!get_varint(pos, view.data + view.footer.keyframes_offset, value)) return false; // the runs must end before the keyframes
+    run.actions = (uint8_t)(value & ((1 << REPLAY_ACTION_BITS) - 1));
+    run.frames = value >> REPLAY_ACTION_BITS;
+    return run.frames > 0 || value == 0;
+}
+
+/* read a keyframe index entry */
+static replay_index_entry index_entry(const replay_view &view, uint32_t i) {
+    const uint8_t *data = view.data + view.footer.index_offset + i * REPLAY_INDEX_ENTRY_SIZE;
+    return {load_le(data, 8), load_le(data + 8, 8), load_le(data + 16, 8)};
+}
+
+/* encode the current run, if there is one */
+static void flush_run(replay_recorder &recorder) {
+    if(recorder.run_frames == 0) return;
+    put_varint(recorder.data, recorder.run_frames << REPLAY_ACTION_BITS | recorder.run_actions);
+    recorder.run_frames = 0;
+}
+
+/* start recording a game */
+replay_recorder new_recorder(const sim_data &sim) {
+    replay_recorder result;
+    result.run_actions = 0; result.run_frames = 0;
+    result.frames = 0;
+    result.finished = false;
+
+    for(int i = 0; i < 4; i++) result.data.push_back((uint8_t)REPLAY_MAGIC[i]);
+    put_uint(result.data, REPLAY_VERSION, 2);
+    put_uint(result.data, SIM_RATE, 2);
+    put_uint(result.data, sim.seed, 8);
+    put_uint(result.data, (uint32_t)sim.level, 4);
+    put_uint(result.data, sim.field_width, 2);
+    put_uint(result.data, sim.field_height, 2);
+
+    return result;
+}
+
+/* record a frame's actions */
+void record_frame(replay_recorder &recorder, const sim_data &sim, uint8_t actions) {
+    if(recorder.finished) return;
+
+    if(recorder.run_frames == 0 || actions != recorder.run_actions) {
+        flush_run(recorder);
+        recorder.run_actions = actions;
+    }
+
+    if(REPLAY_KEYFRAME_INTERVAL > 0 && recorder.frames % REPLAY_KEYFRAME_INTERVAL == 0) {
+        /* take a keyframe; the current run is to be encoded right where the recording is up to */
+        recorder.index.push_back({recorder.frames, recorder.data.size(), recorder.run_frames});
+        size_t size = snapshot_size(sim.field_width, sim.field_height);
+        recorder.keyframes.resize(recorder.keyframes.size() + size);
+        write_snapshot(sim, &recorder.keyframes[recorder.keyframes.size() - size]);
+    }
+
+    recorder.run_frames++;
+    recorder.frames++;
+}
+
+/* finish recording */
+void finish_recording(replay_recorder &recorder, const sim_data &sim) {
+    if(recorder.finished) return;
+
+    flush_run(recorder);
+    put_varint(recorder.data, 0); // end of the runs
+
+    uint64_t keyframes_offset = recorder.data.size();
+    recorder.data.insert(recorder.data.end(), recorder.keyframes.begin(), recorder.keyframes.end());
+    uint64_t index_offset = recorder.data.size();
+    for(const replay_index_entry &entry : recorder.index) {
+        put_uint(recorder.data, entry.frame, 8);
+        put_uint(recorder.data, entry.run_offset, 8);
+        put_uint(recorder.data, entry.run_skip, 8);
+    }
+
+    put_uint(recorder.data, recorder.frames, 8);
+    put_uint(recorder.data, (uint32_t)sim.score, 4);
+    put_uint(recorder.data, (uint32_t)sim.level, 4);
+    put_uint(recorder.data, sim_hash(sim), 8);
+    put_uint(recorder.data, REPLAY_KEYFRAME_INTERVAL, 4);
+    put_uint(recorder.data, recorder.index.size(), 4);
+    put_uint(recorder.data, keyframes_offset, 8);
+    put_uint(recorder.data, index_offset, 8);
+
+    recorder.keyframes.clear(); recorder.keyframes.shrink_to_fit();
+    recorder.index.clear(); recorder.index.shrink_to_fit();
+    recorder.finished = true;
+}
+
+/* write a recording to a file */
+bool save_replay(const replay_recorder &recorder, const string &path) {
+    ofstream file(path, ios::binary);
+    if(!file) return false;
+    file.write((const char *)recorder.data.data(), recorder.data.size());
+    return (bool)file;
+}
+
+/* open a view of a replay */
+bool open_replay(const uint8_t *data, size_t size, replay_view &view) {
+    if(size < REPLAY_HEADER_SIZE + 1 + REPLAY_FOOTER_SIZE || memcmp(data, REPLAY_MAGIC, 4)) return false;
+    view.data = data; view.size = size;
+
+    replay_header &header = view.header;
+    header.version = (uint16_t)load_le(data + 4, 2);
+    if(header.version != REPLAY_VERSION) return false;
+    header.tick_rate = (int)load_le(data + 6, 2);
+    if(header.tick_rate != SIM_RATE) return false; // the frames would play out at the wrong speed
+    header.seed = load_le(data + 8, 8);
+    header.level = (int)(uint32_t)load_le(data + 16, 4);
+    header.field_width = (int)load_le(data + 20, 2);
+    header.field_height = (int)load_le(data + 22, 2);
+    if(!field_fits<uint16_t>(header.field_width, header.field_height)) return false;
+    view.keyframe_size = snapshot_size(header.field_width, header.field_height);
+
+    const uint8_t *end = data + size - REPLAY_FOOTER_SIZE;
+    replay_footer &footer = view.footer;
+    footer.frames = load_le(end, 8);
+    footer.score = (int)(uint32_t)load_le(end + 8, 4);
+    footer.level = (int)(uint32_t)load_le(end + 12, 4);
+    footer.hash = load_le(end + 16, 8);
+    footer.keyframe_interval = (uint32_t)load_le(end + 24, 4);
+    footer.keyframe_count = (uint32_t)load_le(end + 28, 4);
+    footer.keyframes_offset = load_le(end + 32, 8);
+    footer.index_offset = load_le(end + 40, 8);
+
+    /* the runs, the keyframes and the index must fill the space between the header and the footer exactly */
+    uint64_t body = size - REPLAY_FOOTER_SIZE;
+    if(footer.keyframes_offset <= REPLAY_HEADER_SIZE || footer.keyframes_offset > body || footer.index_offset > body) return false;
+    if(footer.keyframe_count > (body - footer.keyframes_offset) / view.keyframe_size) return false;
+    if(footer.index_offset != footer.keyframes_offset + footer.keyframe_count * view.keyframe_size) return false;
+    if(footer.index_offset + (uint64_t)footer.keyframe_count * REPLAY_INDEX_ENTRY_SIZE != body) return false;
+
+    /* the keyframes must be in order, and pick up from within the runs */
+    for(uint32_t i = 0; i < footer.keyframe_count; i++) {
+        replay_index_entry entry = index_entry(view, i);
+        if(entry.frame > footer.frames || (i > 0 && entry.frame <= index_entry(view, i - 1).frame)) return false;
+        if(entry.run_offset < REPLAY_HEADER_SIZE || entry.run_offset >= footer.keyframes_offset) return false;
+    }
+
+    return true;
+}
+
+/* open a replay file */
+bool open_replay_file(const string &path, replay_file &file) {
+    file.mapping = nullptr; file.mapping_size = 0;
+    file.buffer.clear();
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(handle != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size;
+        if(GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if(mapping) {
+                file.mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if(file.mapping) file.mapping_size = (size_t)size.QuadPart;
+                CloseHandle(mapping); // the view keeps the mapping alive
+            }
+        }
+        CloseHandle(handle);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd >= 0) {
+        struct stat buffer;
+        if(fstat(fd, &buffer) == 0 && buffer.st_size > 0) {
+            void *mapping = mmap(nullptr, buffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED) {
+                file.mapping = mapping;
+                file.mapping_size = buffer.st_size;
+            }
+        }
+        close(fd); // the mapping stays valid
+    }
+#endif
+
+    const uint8_t *data = (const uint8_t *)file.mapping;
+    size_t size = file.mapping_size;
+    if(!data) {
+        /* the file can't be mapped, so read it instead */
+        ifstream stream(path, ios::binary);
+        if(!stream) return false;
+        file.buffer.assign(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+        data = file.buffer.data(); size = file.buffer.size();
+    }
+
+    if(!open_replay(data, size, file.view)) {
+        close_replay(file);
+        return false;
+    }
+    return true;
+}
+
+/* close a replay file */
+void close_replay(replay_file &file) {
+    if(file.mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(file.mapping);
+#else
+        munmap(file.mapping, file.mapping_size);
+#endif
+    }
+    file.mapping = nullptr; file.mapping_size = 0;
+    file.buffer.clear(); file.buffer.shrink_to_fit();
+}
+
+/* check the playback against the keyframes taken at the frame it's up to */
+static bool check_keyframes(const replay_view &view, const sim_data &sim, replay_cursor &cursor) {
+    vector<uint8_t> snapshot;
+    for(; cursor.keyframe < view.footer.keyframe_count; cursor.keyframe++) {
+        replay_index_entry entry = index_entry(view, cursor.keyframe);
+        if(entry.frame > cursor.frame) break; // not there yet
+        if(entry.frame != cursor.frame || entry.run_offset != (uint64_t)(cursor.run - view.data) || entry.run_skip != cursor.skip) return false; // the playback went past it
+
+        snapshot.resize(view.keyframe_size);
+        write_snapshot(sim, snapshot.data());
+        if(memcmp(snapshot.data(), view.data + view.footer.keyframes_offset + cursor.keyframe * view.keyframe_size, view.keyframe_size)) return false;
+    }
+    return true;
+}
+
+/* play a replay on until a number of frames have been played in total, checking it against the keyframes on the way if asked to */
+static bool play_runs(const replay_view &view, sim_data &sim, replay_cursor &cursor, uint64_t target, bool check) {
+    while(true) {
+        if(check && !check_keyframes(view, sim, cursor)) return false;
+        if(cursor.frame == target) return true;
+
+        const uint8_t *next = cursor.run;
+        replay_run run;
+        if(!read_run(view, next, run) || cursor.skip >= run.frames) return false; // corrupt, or out of runs
+
+        uint64_t frames = MIN(run.frames - cursor.skip, target - cursor.frame);
+        if(check && cursor.keyframe < view.footer.keyframe_count) frames = MIN(frames, index_entry(view, cursor.keyframe).frame - cursor.frame); // stop at the next keyframe
+
+        uint64_t done = (run.actions) ? 0 : idle_sim(sim, frames); // skip through idle runs
+        for(; done < frames; done++) step_sim(sim, run.actions); // (idle_sim() stops at game over, but step_sim() still counts the frames)
+
+        cursor.frame += frames;
+        cursor.skip += frames;
+        if(cursor.skip == run.frames) {
+            cursor.run = next;
+            cursor.skip = 0;
+        }
+    }
+}
+
+/* get a replayed game's state at a frame */
+bool seek_replay(const replay_view &view, uint64_t frame, sim_data &sim) {
+    if(frame > view.footer.frames) return false;
+    const replay_header &header = view.header;
+
+    /* find the last keyframe at or before the frame */
+    uint32_t low = 0, high = view.footer.keyframe_count; // the keyframe is before high, and at or after low - 1
+    while(low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if(index_entry(view, mid).frame <= frame) low = mid + 1;
+        else high = mid;
+    }
+
+    sim_data result;
+    replay_cursor cursor = {view.data + REPLAY_HEADER_SIZE, 0, 0, 0};
+    if(low > 0) {
+        replay_index_entry entry = index_entry(view, low - 1);
+        if(!read_snapshot(view.data + view.footer.keyframes_offset + (low - 1) * view.keyframe_size, header.field_width, header.field_height, result)) return false;
+        cursor.run = view.data + entry.run_offset; cursor.skip = entry.run_skip; cursor.frame = entry.frame;
+    } else result = new_sim(header.level, header.seed, header.field_width, header.field_height);
+
+    if(!play_runs(view, result, cursor, frame, false)) return false;
+    copy_sim(sim, result);
+    return true;
+}
+
+/* play back a replay and check its results */
+replay_status verify_replay(const replay_view &view, sim_data *sim) {
+    const replay_header &header = view.header;
+    const replay_footer &footer = view.footer;
+
+    sim_data result = new_sim(header.level, header.seed, header.field_width, header.field_height);
+    replay_cursor cursor = {view.data + REPLAY_HEADER_SIZE, 0, 0, 0};
+    bool ok = play_runs(view, result, cursor, footer.frames, true);
+    if(sim) copy_sim(*sim, result);
+    if(!ok) return REPLAY_MISMATCH;
+
+    /* every keyframe must have been checked, and the runs must end where the playback has */
+    replay_run run;
+    const uint8_t *next = cursor.run;
+    if(cursor.keyframe != footer.keyframe_count || cursor.skip != 0 || !read_run(view, next, run) || run.frames != 0) return REPLAY_MISMATCH;
+
+    return (result.score == footer.score && result.level == footer.level && sim_hash(result) == footer.hash) ? REPLAY_OK : REPLAY_MISMATCH;
+}
+
+/* verify replay files in parallel */
+vector<replay_status> verify_replays(thread_pool &pool, const vector<string> &paths, uint64_t *frames) {
+    vector<replay_status> result(paths.size());
+    atomic<uint64_t> total(0);
+
+    pool_parallel_for(pool, paths.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            replay_file file;
+            if(!open_replay_file(paths[i], file)) {
+                result[i] = REPLAY_UNREADABLE;
+                continue;
+            }
+            result[i] = verify_replay(file.view);
+            total += file.view.footer.frames;
+            close_replay(file);
+        }
+    });
+
+    if(frames) *frames = total;
+    return result;
+}
+/* verify replay files from the command line */
+int verify_main(int argc, char *argv[]) {
+    if(argc < 4) {
+        write_line("Usage: " + string(argv[0]) + " --verify <threads (0 for all)> <replay files...>");
+        return 1;
+    }
+    int threads = atoi(argv[2]);
+    vector<string> paths(argv + 3, argv + argc);
+
+    thread_pool pool;
+    start_thread_pool(pool, threads);
+    uint64_t frames = 0;
+    auto start = chrono::steady_clock::now();
+    vector<replay_status> results = verify_replays(pool, paths, &frames);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    threads = pool_threads(pool);
+    stop_thread_pool(pool);
+
+    int failed = 0;
+    for(size_t i = 0; i < paths.size(); i++) {
+        if(results[i] == REPLAY_OK) continue;
+        write_line(paths[i] + ": " + ((results[i] == REPLAY_UNREADABLE) ? "unreadable" : "mismatch"));
+        failed++;
+    }
+
+    write_line("Replays: " + to_string(paths.size()) + " (" + to_string(failed) + " failed), threads: " + to_string(threads));
+    write_line("Frames: " + to_string(frames) + ", time: " + to_string(seconds) + " s, " + to_string((long long)(frames / MAX(seconds, 1e-9))) + " frames/s (" + to_string((long long)(frames / (double)SIM_RATE / MAX(seconds, 1e-9))) + "x real time)");
+
+    return (failed) ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "sim.h"
+#include "thread_pool.h"
+#include "config.h"
+
+using namespace std;
+
+/**
+ * @brief The replay file magic number, which every replay file starts with.
+ *
+ */
+#define REPLAY_MAGIC            "TRPL"
+
+/**
+ * @brief The replay file format version. This is bumped whenever the format changes, and replays of other versions are rejected.
+ *
+ */
+#define REPLAY_VERSION          6
+
+/**
+ * @brief The number of bits that a frame's actions take up in an encoded run; the rest of the run's varint holds its length.
+ *
+ */
+#define REPLAY_ACTION_BITS      6
+
+/**
+ * @brief The size of an encoded replay header (in bytes).
+ *
+ */
+#define REPLAY_HEADER_SIZE      24
+
+/**
+ * @brief The size of an encoded keyframe index entry (in bytes).
+ *
+ */
+#define REPLAY_INDEX_ENTRY_SIZE 24
+
+/**
+ * @brief The size of an encoded replay footer (in bytes).
+ *
+ */
+#define REPLAY_FOOTER_SIZE      48
+
+/**
+ * @brief Replay header, which holds everything needed to set up the simulation that the recorded inputs are played back on. The header is stored as REPLAY_HEADER_SIZE bytes: the magic number (4 bytes), then the version (2 bytes), the simulation tick rate (2 bytes), the seed (8 bytes), the starting level (4 bytes), and the playing field width and height (2 bytes each), all little endian.
+ *
+ * @field version The file format version.
+ * @field tick_rate The simulation tick rate (see SIM_RATE) that the replay has been recorded at; replays of other rates are rejected.
+ * @field seed The simulation's seed.
+ * @field level The starting level.
+ * @field field_width The playing field's width (in cells).
+ * @field field_height The playing field's height (in cells).
+ *
+ */
+struct replay_header {
+    uint16_t version;
+    int tick_rate;
+    uint64_t seed;
+    int level;
+    int field_width;
+    int field_height;
+};
+
+/**
+ * @brief A run of frames with the same actions. Runs follow the header, each stored as a varint (7 bits per byte, least significant group first) of its length shifted left by REPLAY_ACTION_BITS, ORed with its actions, so that single frames take a single byte, and runs of up to 255 frames take two. A varint of zero (i.e. a run of no frames) marks the end of the runs.
+ *
+ * @field actions The actions on each frame of the run; see handle_sim_input().
+ * @field frames The number of frames in the run.
+ *
+ */
+struct replay_run {
+    uint8_t actions;
+    uint64_t frames;
+};
+
+/**
+ * @brief A keyframe index entry, which tells where the inputs pick up from after a keyframe. The keyframes (each a snapshot of the game's state, see write_snapshot()) are stored one after another after the runs' end marker, followed by their index entries, each stored as REPLAY_INDEX_ENTRY_SIZE bytes: the three fields below, 8 bytes each, little endian.
+ *
+ * @field frame The number of recorded frames that had been played when the keyframe was taken.
+ * @field run_offset The offset (from the start of the file) of the run that the keyframe's frame is in.
+ * @field run_skip The number of that run's frames that had already been played when the keyframe was taken.
+ *
+ */
+struct replay_index_entry {
+    uint64_t frame;
+    uint64_t run_offset;
+    uint64_t run_skip;
+};
+
+/**
+ * @brief Replay footer, which records how the game ended up (for checking playbacks against) and where the keyframes are. The footer ends the file, and is stored as REPLAY_FOOTER_SIZE bytes: the number of frames (8 bytes), the score and the level (4 bytes each), the state hash (8 bytes), the keyframe interval and count (4 bytes each), then the keyframes' and the index's offsets from the start of the file (8 bytes each), all little endian.
+ *
+ * @field frames The number of recorded frames.
+ * @field score The final score.
+ * @field level The final level.
+ * @field hash The final state's hash; see sim_hash().
+ * @field keyframe_interval The number of frames between keyframes.
+ * @field keyframe_count The number of keyframes.
+ * @field keyframes_offset The offset of the first keyframe.
+ * @field index_offset The offset of the first keyframe index entry.
+ *
+ */
+struct replay_footer {
+    uint64_t frames;
+    int score;
+    int level;
+    uint64_t hash;
+    uint32_t keyframe_interval;
+    uint32_t keyframe_count;
+    uint64_t keyframes_offset;
+    uint64_t index_offset;
+};
+
+/**
+ * @brief A view of an encoded replay, which reads straight from the encoded bytes (e.g. a memory-mapped file) without copying or decoding them up front.
+ *
+ * @field data The encoded replay.
+ * @field size The encoded replay's size (in bytes).
+ * @field header The decoded header.
+ * @field footer The decoded footer.
+ * @field keyframe_size The size of each keyframe (in bytes); see snapshot_size().
+ *
+ */
+struct replay_view {
+    const uint8_t *data;
+    size_t size;
+    replay_header header;
+    replay_footer footer;
+    size_t keyframe_size;
+};
+
+/**
+ * @brief A replay file mapped into memory (or, where memory mapping isn't available, read into it).
+ *
+ * @field view The view of the file's contents.
+ * @field buffer The file's contents, if they have been read rather than mapped.
+ * @field mapping The memory mapping's base address, if the file has been mapped.
+ * @field mapping_size The memory mapping's size.
+ *
+ */
+struct replay_file {
+    replay_view view;
+    vector<uint8_t> buffer;
+    void *mapping;
+    size_t mapping_size;
+};
+
+/**
+ * @brief Input recorder, which encodes a game's actions frame by frame as it's played, and takes keyframes every REPLAY_KEYFRAME_INTERVAL frames. Runs are only encoded once they end, so the recorder keeps the current run on the side; keyframes and their index are kept on the side too, until the recording is finished.
+ *
+ * @field data The encoded replay so far.
+ * @field run_actions The current run's actions.
+ * @field run_frames The number of frames in the current run, or 0 if there's none yet.
+ * @field frames The number of frames recorded so far.
+ * @field keyframes The keyframes taken so far.
+ * @field index The keyframes' index entries.
+ * @field finished Set once the recording has been finished, after which no more frames are recorded.
+ *
+ */
+struct replay_recorder {
+    vector<uint8_t> data;
+    uint8_t run_actions;
+    uint64_t run_frames;
+    uint64_t frames;
+    vector<uint8_t> keyframes;
+    vector<replay_index_entry> index;
+    bool finished;
+};
+
+/**
+ * @brief Start recording a game.
+ *
+ * @param sim The game's simulation data structure, which must not have been stepped yet.
+ * @return replay_recorder The input recorder.
+ */
+replay_recorder new_recorder(const sim_data &sim);
+
+/**
+ * @brief Record a frame's actions. This is to be called once for each call to step_sim() (or handle_sim_input() and update_sim()) on the recorded game, with the same actions, before the frame is stepped.
+ *
+ * @param recorder The input recorder.
+ * @param sim The recorded game's simulation data structure, as it is before the frame, for taking keyframes.
+ * @param actions The frame's actions; see handle_sim_input().
+ */
+void record_frame(replay_recorder &recorder, const sim_data &sim, uint8_t actions);
+
+/**
+ * @brief Finish a recording, writing its keyframes, their index and the footer. Nothing is recorded after this.
+ *
+ * @param recorder The input recorder.
+ * @param sim The recorded game's simulation data structure, as it is after its last recorded frame.
+ */
+void finish_recording(replay_recorder &recorder, const sim_data &sim);
+
+/**
+ * @brief Write a finished recording to a file.
+ *
+ * @param recorder The input recorder.
+ * @param path The file's path.
+ * @return true Returned if the file has been written.
+ * @return false Returned otherwise.
+ */
+bool save_replay(const replay_recorder &recorder, const string &path);
+
+/**
+ * @brief Open a view of an encoded replay, checking its header, footer and layout. The runs aren't checked until they're played.
+ *
+ * @param data The encoded replay, which must stay valid for as long as the view is used.
+ * @param size The encoded replay's size (in bytes).
+ * @param view The replay view.
+ * @return true Returned if the view has been opened.
+ * @return false Returned if it's not a valid replay of the current version and tick rate.
+ */
+bool open_replay(const uint8_t *data, size_t size, replay_view &view);
+
+/**
+ * @brief Open a replay file, mapping it into memory (with mmap() on POSIX systems and file mappings on Windows) so that it's only read as it's used.
+ *
+ * @param path The file's path.
+ * @param file The replay file; see close_replay().
+ * @return true Returned if the replay has been opened.
+ * @return false Returned if the file can't be read, or isn't a valid replay of the current version and tick rate.
+ */
+bool open_replay_file(const string &path, replay_file &file);
+
+/**
+ * @brief Close a replay file opened with open_replay_file().
+ *
+ * @param file The replay file.
+ */
+void close_replay(replay_file &file);
+
+/**
+ * @brief Get the state of a replayed game at a given frame. The nearest keyframe at or before the frame is found with a binary search of the index, and the game is played on from there, so at most keyframe_interval frames are simulated.
+ *
+ * @param view The replay view.
+ * @param frame The number of recorded frames to have been played, up to the replay's number of frames.
+ * @param sim The simulation data structure to put the state into.
+ * @return true Returned if the state has been found.
+ * @return false Returned if the frame is past the end of the replay, or the replay is corrupt.
+ */
+bool seek_replay(const replay_view &view, uint64_t frame, sim_data &sim);
+
+/**
+ * @brief Replay verification outcomes.
+ *
+ */
+enum replay_status {
+    REPLAY_OK,          // the playback matches the recorded results
+    REPLAY_UNREADABLE,  // the file can't be read, or isn't a valid replay of the current version and tick rate
+    REPLAY_MISMATCH     // the playback ends up with different results than were recorded
+};
+
+/**
+ * @brief Play a replay back from the start, and check that it goes through every keyframe and ends up with the recorded number of frames, score, level and state hash.
+ *
+ * @param view The replay view.
+ * @param sim The simulation as it is after the replay's last frame (optional).
+ * @return replay_status The verification outcome.
+ */
+replay_status verify_replay(const replay_view &view, sim_data *sim = nullptr);
+
+/**
+ * @brief Verify many replay files in parallel on a thread pool.
+ *
+ * @param pool The thread pool to verify the replays on.
+ * @param paths The replay files' paths.
+ * @param frames The total number of frames played back across all replays (optional).
+ * @return vector<replay_status> Each replay's outcome, in the same order as the paths.
+ */
+vector<replay_status> verify_replays(thread_pool &pool, const vector<string> &paths, uint64_t *frames = nullptr);
+
+/**
+ * @brief Verify replay files from the command line, playing them back as fast as possible without rendering, and print the results. The program's return value is 0 only if every replay passes. Usage: --verify <threads (0 for all)> <replay files...>
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return int The program's return value.
+ */
+int verify_main(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,150 @@
+#include "rewind.h"
+#include "utils.h"
+
+using namespace std;
+
+/* the number of bytes of a state up to and including its used bitboard rows, which copy_sim() copies */
+static inline size_t state_head_size(const sim_data &sim) {
+    return offsetof(sim_data, field_rows) + sim.field_height * sizeof(sim.field_rows[0]);
+}
+
+/* the number of bytes of a state */
+static inline size_t state_size(const sim_data &sim) {
+    return state_head_size(sim) + sim.field_width * sim.field_height;
+}
+
+/* the largest encoded delta of a state, i.e. one where every byte has changed */
+static inline size_t max_delta_size(size_t size) {
+    return 2 * size + 2;
+}
+
+/* copy a state's bytes out of a simulation */
+static void store_state(uint8_t *data, const sim_data &sim) {
+    size_t head = state_head_size(sim);
+    memcpy(data, &sim, head);
+    memcpy(data + head, sim.playing_field, sim.field_width * sim.field_height);
+}
+
+/* copy a state's bytes into a simulation */
+static void load_state(sim_data &sim, const uint8_t *data) {
+    size_t head = state_head_size(sim); // the field size never changes within a game
+    memcpy(&sim, data, head);
+    memcpy(sim.playing_field, data + head, sim.field_width * sim.field_height);
+}
+
+/* encode the XOR of two states as (unchanged run length, changed run length, changed bytes) triplets, with both lengths capped at 255 */
+static size_t encode_delta(const uint8_t *a, const uint8_t *b, size_t size, uint8_t *out) {
+    size_t pos = 0, len = 0;
+    while(pos < size) {
+        uint8_t skip = 0, count = 0;
+        while(pos < size && skip < 255 && a[pos] == b[pos]) { pos++; skip++; }
+
+        uint8_t *header = out + len;
+        len += 2;
+        while(pos < size && count < 255 && a[pos] != b[pos]) { out[len++] = a[pos] ^ b[pos]; pos++; count++; }
+
+        header[0] = skip; header[1] = count;
+    }
+    return len;
+}
+
+/* XOR an encoded delta into a state */
+static void apply_delta(uint8_t *data, const uint8_t *delta, size_t len) {
+    size_t pos = 0;
+    for(size_t i = 0; i < len; ) {
+        pos += delta[i];
+        uint8_t count = delta[i + 1];
+        i += 2;
+        for(uint8_t j = 0; j < count; j++) data[pos++] ^= delta[i++];
+    }
+}
+
+/* get a state in the entries ring, counting from the oldest */
+static inline rewind_entry &nth_entry(rewind_buffer &buffer, int n) {
+    return buffer.entries[(buffer.first + n) % REWIND_STATES];
+}
+
+/* drop the oldest state */
+static inline void drop_oldest(rewind_buffer &buffer) {
+    buffer.first = (buffer.first + 1) % REWIND_STATES;
+    buffer.count--;
+}
+
+/* create rewind buffer */
+rewind_buffer new_rewind_buffer(const sim_data &sim) {
+    rewind_buffer result;
+
+    size_t size = state_size(sim);
+    result.arena.resize(max((size_t)REWIND_ARENA_SIZE, max_delta_size(size)));
+    result.entries.resize(REWIND_STATES);
+    result.newest.resize(size);
+    result.scratch.resize(size + max_delta_size(size));
+
+    /* the oldest state's delta is never applied, so it needn't be stored */
+    store_state(result.newest.data(), sim);
+    result.newest_key = sim.field_key;
+    result.rewound = false;
+    result.entries[0] = {sim.frame_num, 0, 0};
+    result.first = 0; result.count = 1;
+    result.arena_next = 0;
+
+    return result;
+}
+
+/* capture the game's state once its playing field has changed */
+bool capture_state(rewind_buffer &buffer, const sim_data &sim) {
+    if(sim.field_key == buffer.newest_key) return false; // no piece has been merged since the last capture
+
+    /* encode the step back from this state to the newest one */
+    size_t size = buffer.newest.size();
+    uint8_t *state = buffer.scratch.data(), *delta = state + size;
+    store_state(state, sim);
+    size_t len = encode_delta(state, buffer.newest.data(), size, delta);
+
+    size_t offset = buffer.arena_next;
+    bool wrapped = offset + len > buffer.arena.size();
+    if(wrapped) offset = 0; // wrap around rather than splitting the delta, giving up the rest of the arena
+
+    /* make room: drop the oldest states while the ring is full, too old, or has a delta where this one goes (the oldest state's own delta isn't needed) */
+    uint64_t frame_min = (sim.frame_num > (uint64_t)(REWIND_SECONDS * SIM_RATE)) ? (sim.frame_num - (uint64_t)(REWIND_SECONDS * SIM_RATE)) : 0;
+    while(buffer.count > 0) {
+        if(buffer.count == REWIND_STATES || nth_entry(buffer, 0).frame < frame_min) {
+            drop_oldest(buffer);
+            continue;
+        }
+        if(buffer.count < 2) break;
+        const rewind_entry &next = nth_entry(buffer, 1);
+        if((wrapped && next.offset >= buffer.arena_next) || (next.offset < offset + len && offset < next.offset + next.size)) drop_oldest(buffer);
+        else break;
+    }
+
+    memcpy(buffer.arena.data() + offset, delta, len);
+    buffer.arena_next = offset + len;
+    nth_entry(buffer, buffer.count++) = {sim.frame_num, offset, len};
+
+    memcpy(buffer.newest.data(), state, size);
+    buffer.newest_key = sim.field_key;
+    buffer.rewound = false;
+
+    return true;
+}
+
+/* step the game back */
+bool rewind_state(rewind_buffer &buffer, sim_data &sim) {
+    if(buffer.count == 0) return false;
+
+    rewind_entry &newest = nth_entry(buffer, buffer.count - 1);
+    if(buffer.rewound || sim.frame_num == newest.frame) {
+        /* already at the newest state (stepped back to it, or just captured), so drop it and step back to the one before */
+        if(buffer.count < 2) return false;
+        apply_delta(buffer.newest.data(), buffer.arena.data() + newest.offset, newest.size);
+        buffer.arena_next = newest.offset; // the delta's space can be reused straight away
+        buffer.count--;
+    }
+
+    load_state(sim, buffer.newest.data());
+    buffer.newest_key = sim.field_key;
+    buffer.rewound = true;
+
+    return true;
+}
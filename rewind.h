@@ -0,0 +1,78 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "sim.h"
+#include "config.h"
+
+using namespace std;
+
+/**
+ * @brief A state kept in the rewind buffer. Each state is stored as the XOR of its bytes with the next older state's, encoded as alternating runs of unchanged bytes (which are skipped) and changed bytes (which are stored as they are).
+ *
+ * @field frame The state's frame number.
+ * @field offset The offset of the state's encoded delta in the arena.
+ * @field size The size of the state's encoded delta (in bytes).
+ *
+ */
+struct rewind_entry {
+    uint64_t frame;
+    size_t offset;
+    size_t size;
+};
+
+/**
+ * @brief Rewind buffer: a fixed-size ring of the game's recent states, captured whenever a piece is merged into the playing field. Only the newest state is kept in full; each older state is kept as a delta against the state after it, so that stepping back is a single delta applied to the newest state. All memory is allocated up front, and once it's full (or the oldest state is more than REWIND_SECONDS old), the oldest states are dropped.
+ *
+ * @field arena The ring of encoded deltas, REWIND_ARENA_SIZE bytes long.
+ * @field entries The ring of states, REWIND_STATES long.
+ * @field first The index of the oldest state in the entries ring.
+ * @field count The number of states kept.
+ * @field arena_next The arena offset that the next delta is to be written at.
+ * @field newest The newest state's bytes, in full.
+ * @field newest_key The newest state's playing field Zobrist key, for telling when the field has changed.
+ * @field rewound Whether the game has been stepped back to the newest state since it was captured, so that the next step back goes past it, however many frames have been simulated in between.
+ * @field scratch Workspace for the state being captured and its encoded delta.
+ *
+ */
+struct rewind_buffer {
+    vector<uint8_t> arena;
+    vector<rewind_entry> entries;
+    int first;
+    int count;
+    size_t arena_next;
+
+    vector<uint8_t> newest;
+    uint64_t newest_key;
+    bool rewound;
+    vector<uint8_t> scratch;
+};
+
+/**
+ * @brief Create a rewind buffer, allocating all of its memory, and capture a game's current state as its first state.
+ *
+ * @param sim The game's simulation data structure.
+ * @return rewind_buffer The rewind buffer.
+ */
+rewind_buffer new_rewind_buffer(const sim_data &sim);
+
+/**
+ * @brief Capture a game's state if a piece has been merged into its playing field since the last captured state (i.e. if the field has changed). This is meant to be called on every frame, and doesn't allocate.
+ *
+ * @param buffer The rewind buffer.
+ * @param sim The game's simulation data structure.
+ * @return true Returned if the state has been captured.
+ * @return false Returned otherwise.
+ */
+bool capture_state(rewind_buffer &buffer, const sim_data &sim);
+
+/**
+ * @brief Step a game back to the newest captured state, or, if it's already there (having been stepped back to it, or captured on this frame), to the state before it (dropping the newest one). Each call thus moves back by one state. The state is restored straight from the buffer, without simulating anything or allocating.
+ *
+ * @param buffer The rewind buffer.
+ * @param sim The game's simulation data structure.
+ * @return true Returned if the game has been stepped back.
+ * @return false Returned if there's nothing older to step back to.
+ */
+bool rewind_state(rewind_buffer &buffer, sim_data &sim);
+
+#endif
@@ -0,0 +1,55 @@
+#include "rng.h"
+
+using namespace std;
+
+/* splitmix64 - used to expand the seed into the generator's state */
+static uint64_t splitmix64(uint64_t &x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* seed a new generator */
+rng_state new_rng(uint64_t seed) {
+    rng_state result;
+
+    uint64_t a = splitmix64(seed), b = splitmix64(seed);
+    result.s[0] = (uint32_t)a; result.s[1] = (uint32_t)(a >> 32);
+    result.s[2] = (uint32_t)b; result.s[3] = (uint32_t)(b >> 32);
+    if(!(result.s[0] | result.s[1] | result.s[2] | result.s[3])) result.s[0] = 1; // the all-zero state is the only one that xoshiro can't get out of
+
+    return result;
+}
+
+/* generate a seed from the clock */
+uint64_t new_seed() {
+    uint64_t x = (uint64_t)chrono::high_resolution_clock::now().time_since_epoch().count();
+    return splitmix64(x);
+}
+
+/* rotate left */
+static inline uint32_t rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+/* xoshiro128** next output */
+uint32_t rng_next(rng_state &rng) {
+    uint32_t result = rotl(rng.s[1] * 5, 7) * 9;
+    uint32_t t = rng.s[1] << 9;
+
+    rng.s[2] ^= rng.s[0];
+    rng.s[3] ^= rng.s[1];
+    rng.s[1] ^= rng.s[2];
+    rng.s[0] ^= rng.s[3];
+    rng.s[2] ^= t;
+    rng.s[3] = rotl(rng.s[3], 11);
+
+    return result;
+}
+
+/* random integer in [min, max] */
+int rng_range(rng_state &rng, int min, int max) {
+    uint64_t span = (uint64_t)(max - min + 1);
+    return min + (int)(((uint64_t)rng_next(rng) * span) >> 32); // multiply-shift rather than modulo; the bias is negligible for the small ranges we use
+}
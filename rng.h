@@ -0,0 +1,51 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <bits/stdc++.h>
+
+using namespace std;
+
+/**
+ * @brief Pseudorandom number generator state (xoshiro128**). This is small and trivially copyable, so that a game's state (and therefore its future pieces) can be cloned or saved along with it.
+ *
+ * @field s The generator's 128-bit internal state.
+ *
+ */
+struct rng_state {
+    uint32_t s[4];
+};
+
+/**
+ * @brief Create a pseudorandom number generator state from a seed. The same seed always produces the same sequence of numbers.
+ *
+ * @param seed The seed.
+ * @return rng_state The seeded generator state.
+ */
+rng_state new_rng(uint64_t seed);
+
+/**
+ * @brief Generate a new seed from the system clock, for games that don't need to be reproduced from a given seed.
+ *
+ * @return uint64_t The generated seed.
+ */
+uint64_t new_seed();
+
+/**
+ * @brief Generate the next 32-bit pseudorandom number.
+ *
+ * @param rng The generator state.
+ * @return uint32_t The generated number.
+ */
+uint32_t rng_next(rng_state &rng);
+
+/**
+ * @brief Generate a pseudorandom integer in a range.
+ *
+ * @param rng The generator state.
+ * @param min The lower bound of the range (inclusive).
+ * @param max The upper bound of the range (inclusive).
+ * @return int The generated number.
+ */
+int rng_range(rng_state &rng, int min, int max);
+
+#endif
@@ -0,0 +1,86 @@
+#include "savestate.h"
+#include "snapshot.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/* get the save state size */
+size_t save_state_size(int width, int height) {
+    return SAVE_STATE_HEADER_SIZE + snapshot_size(width, height) + SAVE_STATE_FOOTER_SIZE;
+}
+
+/* write a file's contents all the way to disk */
+static bool write_durably(const string &path, const uint8_t *data, size_t size) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if(!file) return false;
+
+    bool ok = fwrite(data, 1, size, file) == size && fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = (fclose(file) == 0) && ok;
+
+    return ok;
+}
+
+/* write a save state */
+bool write_save_state(const sim_data &sim, const string &path) {
+    size_t snapshot = snapshot_size(sim.field_width, sim.field_height);
+    vector<uint8_t> data(save_state_size(sim.field_width, sim.field_height));
+
+    memcpy(data.data(), SAVE_STATE_MAGIC, 4);
+    store_le(data.data() + 4, SAVE_STATE_VERSION, 2);
+    store_le(data.data() + 6, SIM_RATE, 2);
+    store_le(data.data() + 8, sim.field_width, 2);
+    store_le(data.data() + 10, sim.field_height, 2);
+    store_le(data.data() + 12, snapshot, 4);
+    write_snapshot(sim, data.data() + SAVE_STATE_HEADER_SIZE);
+    store_le(data.data() + SAVE_STATE_HEADER_SIZE + snapshot, sim_hash(sim), 8);
+
+    /* write to a temporary file, then swap it in */
+    string temp_path = path + ".tmp";
+    if(!write_durably(temp_path, data.data(), data.size())) {
+        remove(temp_path.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    bool ok = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool ok = rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+    if(!ok) remove(temp_path.c_str());
+
+    return ok;
+}
+
+/* read a save state */
+bool read_save_state(const string &path, int width, int height, sim_data &sim) {
+    size_t size = save_state_size(width, height), snapshot = snapshot_size(width, height);
+    vector<uint8_t> data(size + 1); // one byte over, to catch longer files
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if(!file) return false;
+    size_t read = fread(data.data(), 1, data.size(), file);
+    fclose(file);
+
+    if(read != size || memcmp(data.data(), SAVE_STATE_MAGIC, 4)) return false;
+    if(load_le(data.data() + 4, 2) != SAVE_STATE_VERSION || load_le(data.data() + 6, 2) != SIM_RATE) return false;
+    if((int)load_le(data.data() + 8, 2) != width || (int)load_le(data.data() + 10, 2) != height || load_le(data.data() + 12, 4) != snapshot) return false;
+
+    sim_data result;
+    if(!read_snapshot(data.data() + SAVE_STATE_HEADER_SIZE, width, height, result)) return false;
+    if(sim_hash(result) != load_le(data.data() + SAVE_STATE_HEADER_SIZE + snapshot, 8)) return false; // corrupted
+
+    copy_sim(sim, result);
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include "sim.h"
+
+using namespace std;
+
+/**
+ * @brief The save state file magic number, which every save state file starts with.
+ *
+ */
+#define SAVE_STATE_MAGIC        "TSAV"
+
+/**
+ * @brief The save state file format version. This is bumped whenever the format (including the snapshot layout, see write_snapshot()) changes, and save states of other versions are rejected.
+ *
+ */
+#define SAVE_STATE_VERSION      5
+
+/**
+ * @brief The size of an encoded save state header (in bytes).
+ *
+ */
+#define SAVE_STATE_HEADER_SIZE  16
+
+/**
+ * @brief The size of an encoded save state footer (in bytes).
+ *
+ */
+#define SAVE_STATE_FOOTER_SIZE  8
+
+/**
+ * @brief Get the size of a save state file (in bytes). The layout is fixed for each playing field size: the header (SAVE_STATE_HEADER_SIZE bytes: the magic number (4 bytes), then the version (2 bytes), the simulation tick rate (2 bytes; see SIM_RATE), the playing field width and height (2 bytes each) and the snapshot's size (4 bytes)), then the simulation's snapshot (see write_snapshot()), then the footer (the state's hash, see sim_hash(); 8 bytes), all little endian.
+ *
+ * @param width The playing field's width (in cells).
+ * @param height The playing field's height (in cells).
+ * @return size_t The save state size.
+ */
+size_t save_state_size(int width, int height);
+
+/**
+ * @brief Write a simulation's state to a save state file. The file is written under a temporary name, flushed to disk and then renamed over the old one, so that a crash or power loss leaves either the old file or the new one, never a torn one.
+ *
+ * @param sim The simulation data structure.
+ * @param path The file's path.
+ * @return true Returned if the file has been written.
+ * @return false Returned otherwise; the old file (if any) is left as it was.
+ */
+bool write_save_state(const sim_data &sim, const string &path);
+
+/**
+ * @brief Read a simulation's state from a save state file, checking its header, size and hash.
+ *
+ * @param path The file's path.
+ * @param width The playing field's expected width (in cells).
+ * @param height The playing field's expected height (in cells).
+ * @param sim The simulation data structure to restore the state into.
+ * @return true Returned if the state has been restored.
+ * @return false Returned if the file can't be read, or isn't a valid save state of the current version, the current tick rate and the expected playing field size; sim is left untouched in that case.
+ */
+bool read_save_state(const string &path, int width, int height, sim_data &sim);
+
+#endif
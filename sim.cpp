@@ -0,0 +1,618 @@
+#include "sim.h"
+#include "piece.h"
+#include "utils.h"
+
+using namespace std;
+
+/* create new simulation struct */
+template<typename row_t>
+basic_sim_data<row_t> new_sim(int level, uint64_t seed, int width, int height) {
+    basic_sim_data<row_t> result;
+
+    result.score = 0; result.level = level; result.score_lvlup = 0;
+    result.frame_num = 0; result.gravity_acc = 0; schedule_gravity(result);
+    result.frame_last_move = 0; result.frame_last_down = 0; result.frame_last_rotate = 0; result.frame_last_swap = 0; result.frame_last_hard_drop = 0;
+
+    result.game_over = false; result.frame_game_over = 0;
+
+    /* set up playing field */
+    assert(field_fits<row_t>(width, height) && "playing field size doesn't fit the bitboard row type");
+    const int max_width = field_traits<row_t>::max_width, max_height = field_traits<row_t>::max_height;
+    result.field_width = MIN(MAX(width, FIELD_MIN_SIZE), max_width);
+    result.field_height = MIN(MAX(height, FIELD_MIN_SIZE), max_height);
+    result.row_full = (result.field_width == max_width) ? (row_t)~(row_t)0 : (row_t)(((row_t)1 << result.field_width) - 1);
+    memset(result.field_rows, 0, sizeof(result.field_rows));
+    memset(result.playing_field, NO_COLOUR, result.field_width * result.field_height);
+    for(int x = 0; x < max_width; x++) result.column_tops[x] = (uint16_t)result.field_height;
+
+    /* set up piece generation */
+    result.seed = seed;
+    result.rng = new_rng(seed);
+    result.bag = new_bag();
+    result.next_pieces = new_pieces(result.bag, result.rng, result.field_width);
+
+    refresh_zobrist(result);
+
+    return result;
+}
+
+/* check collision (overlaps) between the falling piece and its surrounding field */
+template<typename row_t>
+uint8_t check_collision(const basic_sim_data<row_t> &sim, const piece &test_piece) {
+    uint8_t result = check_bounds(sim, test_piece);
+
+    /* check for overlaps with occupied cells, one row at a time */
+    const piece_bitmap &bitmap = piece_types[test_piece.type].bitmaps[test_piece.rotation];
+    int top = test_piece.position.y + bitmap.y;
+    const piece_mask<row_t> &mask = piece_mask_at<row_t>(test_piece);
+    int y_start = MAX(top, 0), y_end = MIN(top + bitmap.height, sim.field_height);
+    for(int field_y = y_start; field_y < y_end; field_y++) {
+        if(sim.field_rows[field_y] & mask.rows[field_y - test_piece.position.y]) {
+            result |= COLLISION_LEFT | COLLISION_RIGHT | COLLISION_BOTTOM; // the caller will figure out what this really is
+            break;
+        }
+    }
+
+    return result;
+}
+
+template<typename row_t>
+uint8_t check_collision(const basic_sim_data<row_t> &sim) {
+    return check_collision(sim, sim.next_pieces[0]);
+}
+
+/* find how far a piece can fall */
+template<typename row_t>
+int drop_distance(const basic_sim_data<row_t> &sim, const piece &test_piece, int max_rows) {
+    /* each of the piece's columns lands on its column's top cell, unless that cell is above the piece */
+    const piece_profile &profile = piece_profile_of(test_piece);
+    int result = max_rows;
+    bool overhang = false;
+    for(int x = 0; x < 4; x++) {
+        if(profile.bottoms[x] < 0) continue; // empty column
+        int bottom = test_piece.position.y + profile.bottoms[x], top = sim.column_tops[test_piece.position.x + x];
+        if(top <= bottom) {
+            overhang = true; // the piece is under an overhang, so only a scan will tell what's below it
+            break;
+        }
+        result = MIN(result, top - 1 - bottom);
+    }
+    if(!overhang) return MAX(result, 0);
+
+    /* scan the rows below the piece */
+    const piece_bitmap &bitmap = piece_types[test_piece.type].bitmaps[test_piece.rotation];
+    const piece_mask<row_t> &mask = piece_mask_at<row_t>(test_piece);
+
+    result = MIN(max_rows, floor_distance(sim, test_piece)); // how far the floor lets it fall
+    for(int d = 1; d <= result; d++) {
+        for(int y = bitmap.y; y < bitmap.y + bitmap.height; y++) {
+            int field_y = test_piece.position.y + y + d;
+            if(field_y >= 0 && (sim.field_rows[field_y] & mask.rows[y])) return d - 1; // landed on an occupied cell
+        }
+    }
+
+    return MAX(result, 0);
+}
+
+/* recalculate column heights from the bitboard */
+template<typename row_t>
+void refresh_column_tops(basic_sim_data<row_t> &sim) {
+    for(int x = 0; x < sim.field_width; x++) {
+        int y = 0;
+        while(y < sim.field_height && !(sim.field_rows[y] & ((row_t)1 << x))) y++;
+        sim.column_tops[x] = (uint16_t)y;
+    }
+}
+
+/* get the Zobrist key of a playing field's occupied cells */
+template<typename row_t>
+static uint64_t zobrist_field(const basic_sim_data<row_t> &sim) {
+    uint64_t result = 0;
+    for(int y = 0; y < sim.field_height; y++) result ^= zobrist_row(y, sim.field_rows[y]);
+    return result;
+}
+
+/* recalculate Zobrist keys */
+template<typename row_t>
+void refresh_zobrist(basic_sim_data<row_t> &sim) {
+    sim.field_key = zobrist_field(sim);
+    sim.queue_key = zobrist_queue(sim.next_pieces);
+}
+
+/* work the Zobrist key out from scratch */
+template<typename row_t>
+uint64_t recalculate_zobrist_key(const basic_sim_data<row_t> &sim) {
+    return zobrist_field(sim) ^ zobrist_queue(sim.next_pieces) ^ ((sim.game_over) ? zobrist_keys.game_over : 0);
+}
+
+/* handle left move */
+template<typename row_t>
+void handle_left_move(basic_sim_data<row_t> &sim) {
+    sim.next_pieces[0].position.x--; // try shifting it to the left for testing
+    if(check_collision(sim) & COLLISION_LEFT) {
+        sim.next_pieces[0].position.x++;
+#ifdef DEBUG_INPUT_REJECTIONS
+        write_line("Left move rejected for " + piece_to_string(sim.next_pieces[0]));
+#endif
+    } else sim.frame_last_move = sim.frame_num;
+}
+
+/* handle right move */
+template<typename row_t>
+void handle_right_move(basic_sim_data<row_t> &sim) {
+    sim.next_pieces[0].position.x++;
+    if(check_collision(sim) & COLLISION_RIGHT) {
+        sim.next_pieces[0].position.x--;
+#ifdef DEBUG_INPUT_REJECTIONS
+        write_line("Right move rejected for " + piece_to_string(sim.next_pieces[0]));
+#endif
+    } else sim.frame_last_move = sim.frame_num;
+}
+
+/* handle down move/force */
+template<typename row_t>
+void handle_down_move(basic_sim_data<row_t> &sim) {
+    sim.next_pieces[0].position.y++;
+    if(check_collision(sim) & COLLISION_BOTTOM) {
+        sim.next_pieces[0].position.y--;
+#ifdef DEBUG_INPUT_REJECTIONS
+        write_line("Down move rejected for " + piece_to_string(sim.next_pieces[0]));
+#endif
+    } else {
+        sim.score += SCORE_FORCE_DOWN;
+        sim.frame_last_down = sim.frame_num;
+    }
+}
+
+/* handle piece rotation */
+template<typename row_t>
+void handle_rotate(basic_sim_data<row_t> &sim) {
+    piece new_piece = sim.next_pieces[0]; // rotated piece
+    new_piece.rotation = (new_piece.rotation + 1) % 4;
+
+    bool ok = false; // set if the piece fits
+
+    if(!(check_collision(sim, new_piece) & ~COLLISION_CEILING)) ok = true; // ignore ceiling collision
+    else {
+        /* attempt wall kicking */
+        new_piece.position.x++; // right kick
+        if(!(check_collision(sim, new_piece) & ~COLLISION_CEILING)) ok = true;
+        else {
+            new_piece.position.x -= 2; // left kick
+            if(!(check_collision(sim, new_piece) & ~COLLISION_CEILING)) ok = true;
+        }
+    }
+
+    if(ok) {
+        sim.next_pieces[0] = new_piece;
+        sim.frame_last_rotate = sim.frame_num;
+    }
+#ifdef DEBUG_INPUT_REJECTIONS
+    else write_line("Rotation rejected for " + piece_to_string(sim.next_pieces[0]));
+#endif
+}
+
+/* handle piece swap */
+template<typename row_t>
+void handle_swap(basic_sim_data<row_t> &sim) {
+    piece new_piece = sim.next_pieces[1]; // the piece that we'll be swapping with
+
+    piece_position current_centre = piece_centre_point(sim.next_pieces[0]); // the current falling piece's centre point coordinates
+    piece_position new_centre = piece_centre_point(new_piece, true); // the new falling piece's centre point offset
+
+    /* translate the new piece such that its centre point matches that of the old piece */
+    new_piece.position.x = current_centre.x - new_centre.x;
+    new_piece.position.y = current_centre.y - new_centre.y;
+
+    /* check if the new piece fits */
+    if(!(check_collision(sim, new_piece) & ~COLLISION_CEILING)) {
+        /* yes, it fits */
+        position_piece(sim.next_pieces[0], sim.rng, sim.field_width); // reposition back to the top of the field
+        queue_push(sim.next_pieces, sim.next_pieces[0]); // move the old piece to the back
+        sim.next_pieces[0] = new_piece; // replace the new piece with the one with the calculated values
+        sim.queue_key = zobrist_queue(sim.next_pieces);
+
+        sim.frame_last_swap = sim.frame_num;
+    }
+#ifdef DEBUG_INPUT_REJECTIONS
+    else write_line("Swap rejected for " + piece_to_string(sim.next_pieces[0]) + " (attempted to swap for " + piece_to_string(new_piece) + ")");
+#endif
+}
+
+/* handle hard drop */
+template<typename row_t>
+void handle_hard_drop(basic_sim_data<row_t> &sim) {
+    int fall = drop_distance(sim, sim.next_pieces[0], floor_distance(sim, sim.next_pieces[0])); // a piece sticking out of the top can fall further than the field is high
+    sim.next_pieces[0].position.y += fall;
+    sim.score += fall * SCORE_HARD_DROP;
+    sim.frame_last_hard_drop = sim.frame_num;
+
+    settle_piece(sim);
+}
+
+/* apply a frame's worth of actions */
+template<typename row_t>
+void handle_sim_input(basic_sim_data<row_t> &sim, uint8_t actions) {
+    if(sim.game_over) return; // nothing to control anymore
+
+    if((actions & ACTION_LEFT) && input_ready(sim, sim.frame_last_move, SPEED_INPUT_MOVE))
+        handle_left_move(sim);
+
+    if((actions & ACTION_RIGHT) && input_ready(sim, sim.frame_last_move, SPEED_INPUT_MOVE))
+        handle_right_move(sim);
+
+    if((actions & ACTION_DOWN) && input_ready(sim, sim.frame_last_down, SPEED_INPUT_FORCE_DOWN))
+        handle_down_move(sim);
+
+    if((actions & ACTION_ROTATE) && input_ready(sim, sim.frame_last_rotate, SPEED_INPUT_ROTATE))
+        handle_rotate(sim);
+
+    if((actions & ACTION_SWAP) && input_ready(sim, sim.frame_last_swap, SPEED_INPUT_SWAP))
+        handle_swap(sim);
+
+    if((actions & ACTION_HARD_DROP) && input_ready(sim, sim.frame_last_hard_drop, SPEED_INPUT_HARD_DROP))
+        handle_hard_drop(sim);
+}
+
+/* merge falling piece into playing field */
+template<typename row_t>
+void merge_piece(basic_sim_data<row_t> &sim) {
+    const piece &p = sim.next_pieces[0];
+
+    /* raise the column heights to the piece's top cells */
+    const piece_profile &profile = piece_profile_of(p);
+    for(int x = 0; x < 4; x++) {
+        int field_x = p.position.x + x;
+        if(profile.tops[x] < 0 || field_x < 0 || field_x >= sim.field_width || p.position.y + profile.bottoms[x] < 0) continue; // nothing to merge in this column
+        sim.column_tops[field_x] = (uint16_t)MIN((int)sim.column_tops[field_x], MAX(p.position.y + profile.tops[x], 0));
+    }
+
+    const piece_mask<row_t> &mask = piece_mask_at<row_t>(p);
+    int field_y = p.position.y;
+    for(int y = 0; y < 4; y++, field_y++) {
+        if(field_y < 0 || field_y >= sim.field_height) continue; // skip through out of bound rows
+        row_t row = mask.rows[y] & sim.row_full; // skip through out of bound cells
+        sim.field_key ^= zobrist_row(field_y, (row_t)(row & ~sim.field_rows[field_y]));
+        sim.field_rows[field_y] |= row;
+        uint8_t *cells = &sim.playing_field[field_y * sim.field_width];
+        for(int x = 0; row != 0; x++, row >>= 1) {
+            if(row & 1) cells[x] = piece_types[p.type].p_color;
+        }
+    }
+}
+
+/* remove full rows from playing field and return information */
+template<typename row_t>
+basic_removed_rows<row_t> remove_full_rows(basic_sim_data<row_t> &sim) {
+    basic_removed_rows<row_t> result;
+    result.count = 0;
+
+    /* find full rows first; a row is full when all of its bits are set */
+    int y_lowest = -1; // the lowest full row, which is where compaction starts
+    for(int y = 0; y < sim.field_height; y++) {
+        result.flags[y] = (sim.field_rows[y] == sim.row_full);
+        if(result.flags[y]) {
+            result.count++;
+            y_lowest = y;
+            sim.field_key ^= zobrist_row(y, sim.row_full);
+        }
+    }
+
+    if(result.count == 0) return result; // nothing to remove (which is the case for most pieces)
+
+    /* compact the rows in a single pass from the bottom up, moving each surviving row straight to its final position */
+    int shift[field_traits<row_t>::max_height]; // how far each surviving row moves down
+    int y_dest = y_lowest;
+    for(int y = y_lowest - 1; y >= 0; y--) {
+        if(result.flags[y]) continue; // this row is to be removed, so it'll be overwritten
+
+        memcpy(&sim.playing_field[y_dest * sim.field_width], &sim.playing_field[y * sim.field_width], sim.field_width);
+        sim.field_rows[y_dest] = sim.field_rows[y];
+        sim.field_key ^= zobrist_row(y, sim.field_rows[y]) ^ zobrist_row(y_dest, sim.field_rows[y]);
+        shift[y] = y_dest - y;
+        y_dest--;
+    }
+
+    /* clear the rows vacated at the top */
+    memset(sim.playing_field, NO_COLOUR, (y_dest + 1) * sim.field_width);
+    memset(sim.field_rows, 0, (y_dest + 1) * sizeof(row_t));
+
+    /* move the column heights down with their top cells, or look for the new top cell if that was removed */
+    for(int x = 0; x < sim.field_width; x++) {
+        int top = sim.column_tops[x];
+        if(top > y_lowest) continue; // nothing changed in this column
+        if(!result.flags[top]) sim.column_tops[x] = (uint16_t)(top + shift[top]);
+        else {
+            int y = y_dest + 1;
+            while(y < sim.field_height && !(sim.field_rows[y] & ((row_t)1 << x))) y++;
+            sim.column_tops[x] = (uint16_t)y;
+        }
+    }
+
+    return result;
+}
+
+/* fill a row with a single colour */
+template<typename row_t>
+void fill_row(basic_sim_data<row_t> &sim, int row, piece_colour color) {
+    memset(&sim.playing_field[row * sim.field_width], color, sim.field_width);
+    sim.field_key ^= zobrist_row(row, sim.field_rows[row]);
+    sim.field_rows[row] = (color == NO_COLOUR) ? 0 : sim.row_full;
+    sim.field_key ^= zobrist_row(row, sim.field_rows[row]);
+    refresh_column_tops(sim);
+}
+
+/* award score and level-up to player depending on filled rows */
+template<typename row_t>
+void award_score(basic_sim_data<row_t> &sim, const basic_removed_rows<row_t> &rows) {
+    int i;
+    switch(rows.count) {
+        case 0:
+            /* 0 rows - nothing to do here */
+            break;
+        case 1:
+            /* single */
+            sim.score += SCORE_CLEAR_1;
+            break;
+        case 4:
+            /* tetris */
+            sim.score += SCORE_CLEAR_4;
+            sim.score_lvlup = sim.score; sim.level++; // levelling up based on tetris clearance
+            break;
+        case 2:
+            /* double */
+            for(i = 0; i < sim.field_height - 1; i++) { // we can't declare variables in switch-case
+                if(rows.flags[i]) {
+                    /* we found the first row - check the next one too */
+                    if(rows.flags[i + 1]) sim.score += SCORE_CLEAR_2_CONT; // continuous
+                    else sim.score += SCORE_CLEAR_2_SPLIT; // split
+                    break;
+                }
+            }
+            break;
+        case 3:
+            /* triple */
+            for(i = 0; i < sim.field_height - 2; i++) {
+                if(rows.flags[i]) {
+                    /* we found the first row - check the next two rows */
+                    if(rows.flags[i + 1] && rows.flags[i + 2]) sim.score += SCORE_CLEAR_3_CONT; // continuous
+                    else sim.score += SCORE_CLEAR_3_SPLIT; // split
+                    break;
+                }
+            }
+            break;
+        default:
+            /* does this case even happen? */
+            break;
+    }
+
+    /* levelling up based on score */
+    if(sim.score - sim.score_lvlup >= SCORE_LEVEL_UP) {
+        sim.score_lvlup += SCORE_LEVEL_UP;
+        sim.level++;
+    }
+}
+
+/* generate new next piece */
+template<typename row_t>
+void next_piece(basic_sim_data<row_t> &sim) {
+    queue_push(sim.next_pieces, new_piece(sim.bag, sim.rng, sim.field_width));
+    sim.queue_key = zobrist_queue(sim.next_pieces); // every piece has moved up the queue
+}
+
+/* check for game over condition */
+template<typename row_t>
+bool check_game_over(const basic_sim_data<row_t> &sim) {
+    return (sim.next_pieces[0].position.y + piece_types[sim.next_pieces[0].type].bitmaps[sim.next_pieces[0].rotation].y < 0); // if collision happened with part of the piece above the border
+}
+
+/* lock the falling piece into the playing field */
+template<typename row_t>
+void lock_piece(basic_sim_data<row_t> &sim) {
+    merge_piece(sim); // merge piece into the playing field
+    sim.game_over = check_game_over(sim); // check for game over condition
+    next_piece(sim); // pop next piece out
+
+    if(sim.game_over) {
+        /* game over */
+        sim.frame_game_over = sim.frame_num + gravity_interval(sim.level); // we want the game to freeze for a bit
+    } else {
+        /* the game's still progressing */
+        basic_removed_rows<row_t> rows = remove_full_rows(sim); // find and remove full rows
+        award_score(sim, rows); // then award score to player
+    }
+}
+
+/* lock the falling piece straight away */
+template<typename row_t>
+void settle_piece(basic_sim_data<row_t> &sim) {
+    lock_piece(sim);
+    if(sim.game_over) return;
+
+    /* the new piece starts afresh, as it does after landing by gravity */
+    sim.gravity_acc = 0;
+    schedule_gravity(sim);
+}
+
+/* apply a gravity step */
+template<typename row_t>
+void apply_gravity(basic_sim_data<row_t> &sim, int fall) {
+    int rows = sim.gravity_acc / GRAVITY_ONE; // whole rows to fall by on this step
+    sim.gravity_acc %= GRAVITY_ONE; // the rest is carried over
+
+    sim.next_pieces[0].position.y += fall; // descend falling piece
+    if(fall < rows) {
+        /* falling piece has landed */
+        lock_piece(sim);
+        if(sim.game_over) return; // no more gravity steps
+        sim.gravity_acc = 0; // the new piece starts afresh
+    }
+
+    schedule_gravity(sim);
+}
+
+/* update simulation state */
+template<typename row_t>
+void update_sim(basic_sim_data<row_t> &sim) {
+    if(!sim.game_over && gravity_due(sim)) {
+        /* it's updating time */
+        apply_gravity(sim, drop_distance(sim, sim.next_pieces[0], sim.gravity_acc / GRAVITY_ONE));
+    }
+
+    sim.frame_num++; // advance to next frame
+}
+
+/* advance simulation by one frame */
+template<typename row_t>
+void step_sim(basic_sim_data<row_t> &sim, uint8_t actions) {
+    handle_sim_input(sim, actions);
+    update_sim(sim);
+}
+
+/* advance simulation without input, skipping idle frames */
+template<typename row_t>
+uint64_t idle_sim(basic_sim_data<row_t> &sim, uint64_t frames) {
+    uint64_t end = sim.frame_num + frames, start = sim.frame_num;
+    while(sim.frame_num < end && !sim.game_over) {
+        uint64_t event = next_sim_event(sim);
+        if(event >= end) sim.frame_num = end; // nothing happens in the remaining frames
+        else {
+            sim.frame_num = event; // jump straight to the event
+            update_sim(sim);
+        }
+    }
+    return sim.frame_num - start;
+}
+
+/* run simulation over an action stream without any frame pacing */
+template<typename row_t>
+size_t run_sim(basic_sim_data<row_t> &sim, const uint8_t *actions, size_t frames) {
+    size_t i = 0;
+    while(i < frames && !sim.game_over) {
+        if(actions[i]) {
+            step_sim(sim, actions[i]);
+            i++;
+        } else {
+            /* skip through the frames without actions */
+            size_t idle = 1;
+            while(i + idle < frames && !actions[i + idle]) idle++;
+            i += idle_sim(sim, idle);
+        }
+    }
+    return i;
+}
+
+/* compare the parts of two simulations' states that affect the game's future */
+template<typename row_t>
+bool sim_equal(const basic_sim_data<row_t> &a, const basic_sim_data<row_t> &b) {
+    if(a.score != b.score || a.level != b.level || a.score_lvlup != b.score_lvlup) return false;
+    if(a.field_width != b.field_width || a.field_height != b.field_height) return false;
+
+    for(int i = 0; i < NEXT_PIECES_CNT; i++) {
+        const piece &pa = a.next_pieces[i], &pb = b.next_pieces[i];
+        if(pa.type != pb.type || pa.rotation != pb.rotation || pa.position.x != pb.position.x || pa.position.y != pb.position.y) return false;
+    }
+
+    if(memcmp(a.rng.s, b.rng.s, sizeof(a.rng.s)) || memcmp(a.bag.types, b.bag.types, sizeof(a.bag.types)) || a.bag.next != b.bag.next) return false;
+
+    if(a.frame_num != b.frame_num || a.frame_next_update != b.frame_next_update || a.gravity_acc != b.gravity_acc) return false;
+    if(a.frame_last_move != b.frame_last_move || a.frame_last_down != b.frame_last_down || a.frame_last_rotate != b.frame_last_rotate || a.frame_last_swap != b.frame_last_swap || a.frame_last_hard_drop != b.frame_last_hard_drop) return false;
+    if(a.game_over != b.game_over || a.frame_game_over != b.frame_game_over) return false;
+
+    return !memcmp(a.field_rows, b.field_rows, a.field_height * sizeof(row_t)) && !memcmp(a.playing_field, b.playing_field, a.field_width * a.field_height);
+}
+
+/* mix a value into a running state hash */
+static inline uint64_t hash_mix(uint64_t hash, uint64_t value) {
+    hash = (hash ^ value) * 0xff51afd7ed558ccdULL;
+    return hash ^ (hash >> 32);
+}
+
+/* hash the same parts of a simulation's state as sim_equal() */
+template<typename row_t>
+uint64_t sim_hash(const basic_sim_data<row_t> &sim) {
+    uint64_t result = 0xcbf29ce484222325ULL;
+
+    result = hash_mix(result, (uint64_t)(uint32_t)sim.score << 32 | (uint32_t)sim.level);
+    result = hash_mix(result, (uint64_t)(uint32_t)sim.score_lvlup << 32 | (uint32_t)(sim.field_width << 16 | sim.field_height));
+
+    for(int i = 0; i < NEXT_PIECES_CNT; i++) {
+        const piece &p = sim.next_pieces[i];
+        result = hash_mix(result, (uint64_t)p.type << 56 | (uint64_t)p.rotation << 48 | (uint64_t)(uint16_t)p.position.x << 16 | (uint16_t)p.position.y);
+    }
+
+    result = hash_mix(result, (uint64_t)sim.rng.s[0] << 32 | sim.rng.s[1]);
+    result = hash_mix(result, (uint64_t)sim.rng.s[2] << 32 | sim.rng.s[3]);
+    uint64_t bag = sim.bag.next;
+    for(int i = 0; i < 7; i++) bag = bag << 8 | sim.bag.types[i];
+    result = hash_mix(result, bag);
+
+    result = hash_mix(result, sim.frame_num);
+    result = hash_mix(result, sim.frame_next_update);
+    result = hash_mix(result, sim.gravity_acc);
+    result = hash_mix(result, sim.frame_last_move);
+    result = hash_mix(result, sim.frame_last_down);
+    result = hash_mix(result, sim.frame_last_rotate);
+    result = hash_mix(result, sim.frame_last_swap);
+    result = hash_mix(result, sim.frame_last_hard_drop);
+    result = hash_mix(result, sim.game_over ? sim.frame_game_over : ~(uint64_t)0);
+
+    for(int y = 0; y < sim.field_height; y++) result = hash_mix(result, sim.field_rows[y]);
+
+    /* cell colours, 8 at a time */
+    int cells = sim.field_width * sim.field_height, i;
+    for(i = 0; i + 8 <= cells; i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, &sim.playing_field[i], 8);
+        result = hash_mix(result, chunk);
+    }
+    for(; i < cells; i++) result = hash_mix(result, sim.playing_field[i]);
+
+    return result;
+}
+
+/* gravity for each level */
+static constexpr gravity_table make_gravity_table() {
+    gravity_table result = {};
+    const int levels = gravity_levels();
+    for(int level = 0; level < levels; level++) result.speeds[level] = level_gravity(level);
+    return result;
+}
+
+constexpr gravity_table gravity_speeds = make_gravity_table();
+
+/* instantiate the simulation for each bitboard row type */
+#define INSTANTIATE_SIM(row_t) \
+    template basic_sim_data<row_t> new_sim<row_t>(int level, uint64_t seed, int width, int height); \
+    template uint8_t check_collision(const basic_sim_data<row_t> &sim, const piece &test_piece); \
+    template uint8_t check_collision(const basic_sim_data<row_t> &sim); \
+    template void handle_left_move(basic_sim_data<row_t> &sim); \
+    template void handle_right_move(basic_sim_data<row_t> &sim); \
+    template void handle_down_move(basic_sim_data<row_t> &sim); \
+    template void handle_rotate(basic_sim_data<row_t> &sim); \
+    template void handle_swap(basic_sim_data<row_t> &sim); \
+    template void handle_hard_drop(basic_sim_data<row_t> &sim); \
+    template void refresh_column_tops(basic_sim_data<row_t> &sim); \
+    template void refresh_zobrist(basic_sim_data<row_t> &sim); \
+    template uint64_t recalculate_zobrist_key(const basic_sim_data<row_t> &sim); \
+    template void handle_sim_input(basic_sim_data<row_t> &sim, uint8_t actions); \
+    template void merge_piece(basic_sim_data<row_t> &sim); \
+    template basic_removed_rows<row_t> remove_full_rows(basic_sim_data<row_t> &sim); \
+    template void fill_row(basic_sim_data<row_t> &sim, int row, piece_colour color); \
+    template void award_score(basic_sim_data<row_t> &sim, const basic_removed_rows<row_t> &rows); \
+    template void next_piece(basic_sim_data<row_t> &sim); \
+    template bool check_game_over(const basic_sim_data<row_t> &sim); \
+    template int drop_distance(const basic_sim_data<row_t> &sim, const piece &test_piece, int max_rows); \
+    template void lock_piece(basic_sim_data<row_t> &sim); \
+    template void settle_piece(basic_sim_data<row_t> &sim); \
+    template void apply_gravity(basic_sim_data<row_t> &sim, int fall); \
+    template void update_sim(basic_sim_data<row_t> &sim); \
+    template void step_sim(basic_sim_data<row_t> &sim, uint8_t actions); \
+    template uint64_t idle_sim(basic_sim_data<row_t> &sim, uint64_t frames); \
+    template size_t run_sim(basic_sim_data<row_t> &sim, const uint8_t *actions, size_t frames); \
+    template bool sim_equal(const basic_sim_data<row_t> &a, const basic_sim_data<row_t> &b); \
+    template uint64_t sim_hash(const basic_sim_data<row_t> &sim);
+
+INSTANTIATE_SIM(uint16_t)
+INSTANTIATE_SIM(uint32_t)
+INSTANTIATE_SIM(uint64_t)
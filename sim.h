@@ -0,0 +1,685 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "piece.h"
+#include "config.h"
+#include "rng.h"
+#include "zobrist.h"
+
+using namespace std;
+
+/**
+ * @brief Playing field limits for each bitboard row type. The row type is picked to fit the field's width: 16-bit rows for the default field, and 32-bit or 64-bit rows for large fields.
+ *
+ * @tparam row_t The bitboard row type (uint16_t, uint32_t or uint64_t).
+ * @field max_width The maximum playing field width (in cells), i.e. the number of bits in a row.
+ * @field max_height The maximum playing field height (in cells).
+ *
+ */
+template<typename row_t> struct field_traits;
+
+template<> struct field_traits<uint16_t> {
+    static constexpr int max_width = 16;
+    static constexpr int max_height = FIELD_MAX_HEIGHT_16;
+};
+
+template<> struct field_traits<uint32_t> {
+    static constexpr int max_width = 32;
+    static constexpr int max_height = FIELD_MAX_HEIGHT_32;
+};
+
+template<> struct field_traits<uint64_t> {
+    static constexpr int max_width = 64;
+    static constexpr int max_height = FIELD_MAX_HEIGHT_64;
+};
+
+/**
+ * @brief The smallest playing field width and height (in cells), i.e. room for any piece in any rotation.
+ *
+ */
+#define FIELD_MIN_SIZE          4
+
+/**
+ * @brief Check whether a playing field size can be simulated with a bitboard row type; see field_traits. Callers creating fields of other sizes than the default should use this to pick the narrowest row type that fits.
+ *
+ * @tparam row_t The bitboard row type.
+ * @param width The playing field's width (in cells).
+ * @param height The playing field's height (in cells).
+ * @return true Returned if the size is within the row type's limits.
+ * @return false Returned otherwise.
+ */
+template<typename row_t>
+constexpr bool field_fits(int width, int height) {
+    return width >= FIELD_MIN_SIZE && width <= field_traits<row_t>::max_width && height >= FIELD_MIN_SIZE && height <= field_traits<row_t>::max_height;
+}
+
+static_assert(FIELD_WIDTH <= field_traits<uint16_t>::max_width && FIELD_HEIGHT <= field_traits<uint16_t>::max_height, "the default playing field must fit in 16-bit bitboard rows");
+
+/**
+ * @brief The simulation (game logic) data structure. This holds everything needed to advance a game, and nothing related to rendering or input polling.
+ *
+ * @tparam row_t The bitboard row type, which limits the playing field's size; see field_traits.
+ *
+ * @field score The player's score.
+ * @field level The player's level (zero-based).
+ *
+ * @field score_lvlup The player's score on the last level increment.
+ *
+ * @field field_width The playing field's width (in cells).
+ * @field field_height The playing field's height (in cells).
+ * @field row_full Bitboard row mask with all cells in a row of the playing field occupied.
+ *
+ * @field next_pieces The falling and next pieces queue.
+ *
+ * @field seed The seed that the simulation's pseudorandom number generator was created with. The same seed (and inputs) always reproduces the same game.
+ * @field rng The pseudorandom number generator used for piece generation.
+ * @field bag The piece bag that the next pieces' types are dealt from.
+ *
+ * @field frame_num The current frame number.
+ *
+ * @field frame_next_update The frame number that the falling piece is next due to descend by gravity on; see gravity_due().
+ * @field gravity_acc The gravity accumulator (in GRAVITY_ONE units, i.e. 1/65536 rows) as of frame_next_update. Its integer part is the number of rows that the piece is to fall on that frame, and its fractional part is carried over to the next gravity step.
+ *
+ * @field frame_last_move The frame number of the last accepted left/right move action.
+ * @field frame_last_down The frame number of the last accepted down move action.
+ * @field frame_last_rotate The frame number of the last accepted rotation action.
+ * @field frame_last_swap The frame number of the last accepted piece swap action.
+ * @field frame_last_hard_drop The frame number of the last accepted hard drop action.
+ *
+ * @field game_over Game over flag.
+ * @field frame_game_over The frame number where the game over condition was detected.
+ *
+ * @field column_tops The row of the topmost occupied cell in each column of the playing field, or field_height for empty columns. This is derived from field_rows and kept up to date incrementally by merge_piece() and remove_full_rows(), so that drop_distance() doesn't need to scan the field.
+ * @field field_key The Zobrist key of the playing field's occupied cells (see zobrist_keys), kept up to date incrementally by merge_piece(), remove_full_rows() and fill_row().
+ * @field queue_key The Zobrist key of the next pieces queue (see zobrist_queue()), updated by next_piece() and handle_swap(). It only keys the pieces' types, so the falling piece's moves don't change it.
+ * @field field_rows The playing field's occupancy bitboard, kept in sync with playing_field. Bit x of each row is set when the cell in column x is occupied.
+ * @field playing_field The playing field's cell colours (see piece_colour), stored row after row with field_width cells each; see field_cell().
+ *
+ * The playing field arrays are sized for the largest field that fits row_t, and are kept at the end of the structure so that copy_sim() can skip their unused tails.
+ *
+ */
+template<typename row_t>
+struct basic_sim_data {
+    int score;
+    int level;
+
+    int score_lvlup;
+
+    /* playing field */
+    int field_width;
+    int field_height;
+    row_t row_full;
+
+    piece_queue next_pieces;
+
+    /* piece generation */
+    uint64_t seed;
+    rng_state rng;
+    piece_bag bag;
+
+    uint64_t frame_num;
+
+    uint64_t frame_next_update;
+    uint32_t gravity_acc;
+
+    /* input */
+    uint64_t frame_last_move;
+    uint64_t frame_last_down;
+    uint64_t frame_last_rotate;
+    uint64_t frame_last_swap;
+    uint64_t frame_last_hard_drop;
+
+    /* game over */
+    bool game_over;
+    uint64_t frame_game_over;
+
+    uint16_t column_tops[field_traits<row_t>::max_width];
+
+    uint64_t field_key;
+    uint64_t queue_key;
+
+    /* playing field contents; these must stay last, see copy_sim() */
+    row_t field_rows[field_traits<row_t>::max_height];
+    uint8_t playing_field[field_traits<row_t>::max_height * field_traits<row_t>::max_width];
+};
+
+/**
+ * @brief The simulation data structure for the default playing field size, which is what the interactive game uses.
+ *
+ */
+typedef basic_sim_data<uint16_t> sim_data;
+
+static_assert(is_trivially_copyable<sim_data>::value, "simulation states must be cheap to clone for lookahead search");
+
+/**
+ * @brief Removed rows information.
+ *
+ * @tparam row_t The bitboard row type of the simulation that the rows were removed from.
+ *
+ * @field flags Array of flags indicating which rows have been removed.
+ * @field count The number of removed rows.
+ *
+ */
+template<typename row_t>
+struct basic_removed_rows {
+    bool flags[field_traits<row_t>::max_height];
+    int count;
+};
+
+/**
+ * @brief Removed rows information for the default playing field size.
+ *
+ */
+typedef basic_removed_rows<uint16_t> removed_rows;
+
+/**
+ * @brief Get the colour of a cell in a simulation's playing field.
+ *
+ * @param sim The simulation data structure.
+ * @param x The cell's X coordinate.
+ * @param y The cell's Y coordinate.
+ * @return piece_colour The cell's colour, or NO_COLOUR if it's not occupied.
+ */
+template<typename row_t>
+inline piece_colour field_cell(const basic_sim_data<row_t> &sim, int x, int y) {
+    return (piece_colour)sim.playing_field[y * sim.field_width + x];
+}
+
+/**
+ * @brief Copy a simulation's state into another simulation data structure, skipping the unused parts of the playing field arrays. This is cheaper than plain assignment for small fields in large row types, and is what lookahead search should use to clone states.
+ *
+ * @param dst The destination simulation data structure.
+ * @param src The source simulation data structure.
+ */
+template<typename row_t>
+inline void copy_sim(basic_sim_data<row_t> &dst, const basic_sim_data<row_t> &src) {
+    memcpy(&dst, &src, offsetof(basic_sim_data<row_t>, field_rows) + src.field_height * sizeof(row_t)); // everything up to and including the used bitboard rows
+    memcpy(dst.playing_field, src.playing_field, src.field_width * src.field_height);
+}
+
+/**
+ * @brief Compare two simulations' states. Only the parts of the state that affect the game's future are compared (and not derived data such as column_tops and the Zobrist keys), so two simulations compare equal if and only if they would play out identically given the same inputs.
+ *
+ * @param a The first simulation data structure.
+ * @param b The second simulation data structure.
+ * @return true Returned if both simulations are in the same state.
+ * @return false Returned otherwise.
+ */
+template<typename row_t>
+bool sim_equal(const basic_sim_data<row_t> &a, const basic_sim_data<row_t> &b);
+
+/**
+ * @brief Hash a simulation's state, covering the same parts of it as sim_equal(). The hash only depends on the state's contents, so it is stable across runs.
+ *
+ * @param sim The simulation data structure.
+ * @return uint64_t The state's hash.
+ */
+template<typename row_t>
+uint64_t sim_hash(const basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Get the Zobrist key of a simulation's state, covering its playing field, its next pieces queue and the game over flag. Unlike sim_hash(), this is kept up to date as the state changes, so it costs nothing to get; it's meant for spotting states that search has already seen (see transposition_table).
+ *
+ * @param sim The simulation data structure.
+ * @return uint64_t The state's Zobrist key.
+ */
+template<typename row_t>
+inline uint64_t zobrist_key(const basic_sim_data<row_t> &sim) {
+    return sim.field_key ^ sim.queue_key ^ ((sim.game_over) ? zobrist_keys.game_over : 0);
+}
+
+/**
+ * @brief Bitmask for the left move action. Passed to handle_sim_input().
+ *
+ */
+#define ACTION_LEFT             (1 << 0)
+
+/**
+ * @brief Bitmask for the right move action. Passed to handle_sim_input().
+ *
+ */
+#define ACTION_RIGHT            (1 << 1)
+
+/**
+ * @brief Bitmask for the down move (force down) action. Passed to handle_sim_input().
+ *
+ */
+#define ACTION_DOWN             (1 << 2)
+
+/**
+ * @brief Bitmask for the rotation action. Passed to handle_sim_input().
+ *
+ */
+#define ACTION_ROTATE           (1 << 3)
+
+/**
+ * @brief Bitmask for the piece swap action. Passed to handle_sim_input().
+ *
+ */
+#define ACTION_SWAP             (1 << 4)
+
+/**
+ * @brief Bitmask for the hard drop action. Passed to handle_sim_input().
+ *
+ */
+#define ACTION_HARD_DROP        (1 << 5)
+
+/**
+ * @brief Create a new simulation given the starting level, seed and playing field size.
+ *
+ * @tparam row_t The bitboard row type; this defaults to 16-bit rows, which fit the default playing field. See field_traits for the size limits of each row type.
+ * @param level The game's starting level (defaults to 1st level).
+ * @param seed The seed for piece generation; see new_seed() for an unpredictable one.
+ * @param width The playing field's width (in cells).
+ * @param height The playing field's height (in cells). The size must fit the row type (see field_fits()); this is asserted, and in builds without assertions, out-of-range sizes are clamped so that the field arrays are never overrun.
+ * @return basic_sim_data<row_t> The created simulation data structure.
+ */
+template<typename row_t = uint16_t>
+basic_sim_data<row_t> new_sim(int level = 0, uint64_t seed = 0, int width = FIELD_WIDTH, int height = FIELD_HEIGHT);
+
+/**
+ * @brief Bitmask for left side collision. Returned by check_collision().
+ *
+ */
+#define COLLISION_LEFT          (1 << 0)
+
+/**
+ * @brief Bitmask for right side collision. Returned by check_collision().
+ *
+ */
+#define COLLISION_RIGHT         (1 << 1)
+
+/**
+ * @brief Bitmask for ceiling collision. Returned by check_collision().
+ *
+ */
+#define COLLISION_CEILING       (1 << 2)
+
+/**
+ * @brief Bitmask for bottom (or floor) collision. Returned by check_collision().
+ *
+ */
+#define COLLISION_BOTTOM        (1 << 3)
+
+/**
+ * @brief Check for collision between a test piece and a simulation's playing field boundaries, which can be told from the piece's bounding box alone.
+ *
+ * @param sim The simulation whose playing field will be used to check against.
+ * @param test_piece The test piece to check against.
+ * @return uint8_t Collision status flags; see COLLISION_LEFT, COLLISION_RIGHT, COLLISION_CEILING and COLLISION_BOTTOM.
+ */
+template<typename row_t>
+inline uint8_t check_bounds(const basic_sim_data<row_t> &sim, const piece &test_piece) {
+    uint8_t result = 0;
+
+    const piece_bitmap &bitmap = piece_types[test_piece.type].bitmaps[test_piece.rotation];
+    int top = test_piece.position.y + bitmap.y, left = test_piece.position.x + bitmap.x;
+    if(top < 0) result |= COLLISION_CEILING; // part of the piece is above the upper bound of the playing field
+    if(top + bitmap.height > sim.field_height) result |= COLLISION_BOTTOM; // part of the piece is below the lower bound of the playing field
+    if(left < 0) result |= COLLISION_LEFT;
+    if(left + bitmap.width > sim.field_width) result |= COLLISION_RIGHT;
+
+    return result;
+}
+
+/**
+ * @brief Check for collision between a test piece and a simulation's playing field.
+ *
+ * @param sim The simulation whose playing field will be used to check against.
+ * @param test_piece The test piece to check against.
+ * @return uint8_t Collision status flags; see COLLISION_LEFT, COLLISION_RIGHT, COLLISION_CEILING and COLLISION_BOTTOM.
+ */
+template<typename row_t>
+uint8_t check_collision(const basic_sim_data<row_t> &sim, const piece &test_piece);
+
+/**
+ * @brief Check for collision between the falling piece in a simulation and the playing field.
+ *
+ * @param sim The simulation data structure to check.
+ * @return uint8_t Collision status flags; see COLLISION_LEFT, COLLISION_RIGHT, COLLISION_CEILING and COLLISION_BOTTOM.
+ */
+template<typename row_t>
+uint8_t check_collision(const basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Find how far a piece can fall in a simulation's playing field before landing on the floor or on occupied cells. This takes a few comparisons between the piece's bottom profile (see piece_profiles) and the field's column heights, unless the piece is tucked under an overhang, in which case the field's rows are scanned.
+ *
+ * @param sim The simulation data structure.
+ * @param test_piece The piece, which must not collide with anything where it is.
+ * @param max_rows The maximum distance to look for (in rows). Pass floor_distance() to find where the piece lands, however high up it is.
+ * @return int The number of rows that the piece can fall by, up to max_rows.
+ */
+template<typename row_t>
+int drop_distance(const basic_sim_data<row_t> &sim, const piece &test_piece, int max_rows);
+
+/**
+ * @brief Find how far a piece is above the playing field's floor, i.e. how far it could fall on an empty field. This can be more than the field's height, as a piece can stick out of the top of the field.
+ *
+ * @param sim The simulation data structure.
+ * @param test_piece The piece.
+ * @return int The distance between the piece's bottom and the floor (in rows).
+ */
+template<typename row_t>
+inline int floor_distance(const basic_sim_data<row_t> &sim, const piece &test_piece) {
+    const piece_bitmap &bitmap = piece_types[test_piece.type].bitmaps[test_piece.rotation];
+    return sim.field_height - (test_piece.position.y + bitmap.y + bitmap.height);
+}
+
+/**
+ * @brief Recalculate a simulation's column heights (see column_tops in basic_sim_data) from its playing field bitboard. This is only needed after changing the playing field by other means than merge_piece() and remove_full_rows().
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void refresh_column_tops(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Recalculate a simulation's Zobrist keys (see zobrist_key()) from its playing field bitboard and next pieces queue. Like refresh_column_tops(), this is only needed after changing the state by other means than the simulation's own functions.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void refresh_zobrist(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Work a simulation's Zobrist key out from scratch, from its playing field bitboard, next pieces queue and game over flag, without touching its incrementally kept keys. This is what zobrist_key() gives whenever those keys are up to date (see DEBUG_ZOBRIST).
+ *
+ * @param sim The simulation data structure.
+ * @return uint64_t The state's Zobrist key.
+ */
+template<typename row_t>
+uint64_t recalculate_zobrist_key(const basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Handle left move action.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void handle_left_move(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Handle right move action.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void handle_right_move(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Handle down move action.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void handle_down_move(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Handle piece rotation.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void handle_rotate(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Handle piece swapping action.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void handle_swap(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Handle hard drop action: drop the falling piece as far as it can fall and lock it straight away.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void handle_hard_drop(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Check whether an input action can be accepted on a simulation's current frame, given its speed limit.
+ *
+ * @param sim The simulation data structure.
+ * @param frame_last The frame number that the action was last accepted on (0 if it never was).
+ * @param speed The action's speed limit (in actions per second); see the SPEED_INPUT_* macros in config.h.
+ * @return true Returned if the action can be accepted.
+ * @return false Returned if the action is to be ignored on this frame.
+ */
+template<typename row_t>
+inline bool input_ready(const basic_sim_data<row_t> &sim, uint64_t frame_last, int speed) {
+    return frame_last == 0 || sim.frame_num - frame_last >= (uint64_t)(SIM_RATE / speed);
+}
+
+/**
+ * @brief Fixed-point gravity unit: one row, in the 1/65536 row units that gravity is accumulated in.
+ *
+ */
+#define GRAVITY_ONE             (1 << 16)
+
+/**
+ * @brief Calculate the gravity on a given level.
+ *
+ * @param level The level.
+ * @return uint32_t The gravity (in GRAVITY_ONE units per frame), rounded up and capped at SPEED_MAX_ROWS rows per frame.
+ */
+constexpr uint32_t level_gravity(int level) {
+    double rows = (SPEED_BASE + level * SPEED_STEP) * GRAVITY_ONE / SIM_RATE;
+    uint64_t result = (uint64_t)rows;
+    if(result < rows) result++; // round up
+    return (result < (uint64_t)SPEED_MAX_ROWS * GRAVITY_ONE) ? (uint32_t)result : (uint32_t)SPEED_MAX_ROWS * GRAVITY_ONE;
+}
+
+/**
+ * @brief Calculate the number of entries in the gravity table, i.e. the first level where gravity is capped, plus one.
+ *
+ * @return int The number of levels.
+ */
+constexpr int gravity_levels() {
+    int level = 0;
+    while(level_gravity(level) < (uint32_t)SPEED_MAX_ROWS * GRAVITY_ONE) level++;
+    return level + 1;
+}
+
+/**
+ * @brief Table of precomputed gravity for each level, up to the level where it's capped; see level_gravity().
+ *
+ * @field speeds The gravity for each level (in GRAVITY_ONE units per frame).
+ *
+ */
+struct gravity_table {
+    uint32_t speeds[gravity_levels()];
+};
+
+/**
+ * @brief The gravity table, generated at compile time.
+ *
+ */
+extern const gravity_table gravity_speeds;
+
+/**
+ * @brief Look up the gravity on a given level.
+ *
+ * @param level The level. Levels past the end of the gravity table have the capped gravity.
+ * @return uint32_t The gravity (in GRAVITY_ONE units per frame).
+ */
+inline uint32_t gravity_speed(int level) {
+    constexpr int levels = gravity_levels();
+    return gravity_speeds.speeds[(level < 0) ? 0 : ((level >= levels) ? levels - 1 : level)];
+}
+
+/**
+ * @brief Get the number of frames that the falling piece takes to fall by one row on a given level.
+ *
+ * @param level The level.
+ * @return uint64_t The number of frames per row (at least 1).
+ */
+inline uint64_t gravity_interval(int level) {
+    uint32_t speed = gravity_speed(level);
+    return (GRAVITY_ONE + speed - 1) / speed;
+}
+
+/**
+ * @brief Check whether the falling piece is due to descend by gravity on a simulation's current frame. This is a single comparison against the deadline scheduled at the last gravity step; see next_sim_event().
+ *
+ * @param sim The simulation data structure.
+ * @return true Returned if gravity applies on this frame.
+ * @return false Returned otherwise.
+ */
+template<typename row_t>
+inline bool gravity_due(const basic_sim_data<row_t> &sim) {
+    return sim.frame_num >= sim.frame_next_update;
+}
+
+/**
+ * @brief Schedule a simulation's next gravity step, by advancing its gravity accumulator to the next frame where it reaches a whole row.
+ *
+ * @param sim The simulation data structure. Its gravity accumulator must hold less than a row.
+ */
+template<typename row_t>
+inline void schedule_gravity(basic_sim_data<row_t> &sim) {
+    uint32_t speed = gravity_speed(sim.level);
+    uint32_t frames = (GRAVITY_ONE - sim.gravity_acc + speed - 1) / speed; // frames until the accumulator gets to a whole row
+    sim.frame_next_update = sim.frame_num + frames;
+    sim.gravity_acc += frames * speed;
+}
+
+/**
+ * @brief Get the frame number of a simulation's next event, i.e. the next frame where update_sim() does anything besides advancing the frame counter. Without player input, all frames before it can be skipped; see idle_sim().
+ *
+ * @param sim The simulation data structure.
+ * @return uint64_t The next event's frame number, or UINT64_MAX if there are no more events (i.e. after game over).
+ */
+template<typename row_t>
+inline uint64_t next_sim_event(const basic_sim_data<row_t> &sim) {
+    return (sim.game_over) ? UINT64_MAX : sim.frame_next_update;
+}
+
+/**
+ * @brief Apply a frame's worth of player actions, subject to the input speed limits in config.h.
+ *
+ * @param sim The simulation data structure.
+ * @param actions The actions requested on this frame; see ACTION_LEFT, ACTION_RIGHT, ACTION_DOWN, ACTION_ROTATE, ACTION_SWAP and ACTION_HARD_DROP.
+ */
+template<typename row_t>
+void handle_sim_input(basic_sim_data<row_t> &sim, uint8_t actions);
+
+/**
+ * @brief Merge a simulation's falling piece into its playing field.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void merge_piece(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Detect and remove filled rows in a simulation's playing field.
+ *
+ * @param sim The simulation data structure.
+ * @return basic_removed_rows<row_t> A data structure containing information on the removed rows.
+ */
+template<typename row_t>
+basic_removed_rows<row_t> remove_full_rows(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Fill a row of a simulation's playing field with a single colour. This is used for the game over animation.
+ *
+ * @param sim The simulation data structure.
+ * @param row The row to be filled.
+ * @param color The colour to fill the row with.
+ */
+template<typename row_t>
+void fill_row(basic_sim_data<row_t> &sim, int row, piece_colour color);
+
+/**
+ * @brief Award score to the player depending on the number and pattern of removed filled rows.
+ *
+ * @param sim The simulation data structure.
+ * @param rows Information on removed rows, returned by remove_full_rows().
+ */
+template<typename row_t>
+void award_score(basic_sim_data<row_t> &sim, const basic_removed_rows<row_t> &rows);
+
+/**
+ * @brief Pop the falling piece out of the simulation's next pieces queue and add a new one to its end.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void next_piece(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Check for the game over condition.
+ *
+ * @param sim The simulation data structure.
+ * @return true Returned on game over (i.e. the falling piece is overflowing from the playing field)/
+ * @return false Returned if the game can proceed as usual.
+ */
+template<typename row_t>
+bool check_game_over(const basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Apply a due gravity step: drop a simulation's falling piece by the accumulated whole rows, or as far as it can fall, lock it if it has landed, and schedule the next gravity step.
+ *
+ * @param sim The simulation data structure, whose gravity step is due; see gravity_due().
+ * @param fall How far the piece can fall (in rows), as found by drop_distance() with the accumulated whole rows as its limit.
+ */
+template<typename row_t>
+void apply_gravity(basic_sim_data<row_t> &sim, int fall);
+
+/**
+ * @brief Lock a simulation's falling piece where it is: merge it into the playing field, check for game over, pop the next piece out, and clear rows and award score if the game goes on.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void lock_piece(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Lock a simulation's falling piece where it is straight away (as opposed to when it lands by gravity), then restart gravity for the next piece. This is used for hard drops and for placements picked by bots.
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void settle_piece(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Perform the game's logic for a single frame (gravity, locking, row clearing and scoring).
+ *
+ * @param sim The simulation data structure.
+ */
+template<typename row_t>
+void update_sim(basic_sim_data<row_t> &sim);
+
+/**
+ * @brief Advance the simulation by a single frame: apply the given actions, then update the game logic.
+ *
+ * @param sim The simulation data structure.
+ * @param actions The actions requested on this frame; see handle_sim_input().
+ */
+template<typename row_t>
+void step_sim(basic_sim_data<row_t> &sim, uint8_t actions);
+
+/**
+ * @brief Advance the simulation by a number of frames without any player input, jumping straight from one event to the next (see next_sim_event()) and stopping early on game over. This has the same effect as calling step_sim() with no actions on each frame.
+ *
+ * @param sim The simulation data structure.
+ * @param frames The number of frames to advance by.
+ * @return uint64_t The number of frames that have been simulated.
+ */
+template<typename row_t>
+uint64_t idle_sim(basic_sim_data<row_t> &sim, uint64_t frames);
+
+/**
+ * @brief Run the simulation over an action stream as fast as possible, stopping early on game over. Runs of frames without actions are skipped through with idle_sim().
+ *
+ * @param sim The simulation data structure.
+ * @param actions Array of per-frame actions; see handle_sim_input().
+ * @param frames The number of frames in the actions array.
+ * @return size_t The number of frames that have been simulated.
+ */
+template<typename row_t>
+size_t run_sim(basic_sim_data<row_t> &sim, const uint8_t *actions, size_t frames);
+
+#endif
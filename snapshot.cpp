@@ -0,0 +1,122 @@
+#include "snapshot.h"
+
+using namespace std;
+
+/* write a field and move past it */
+static inline void put(uint8_t *&data, uint64_t value, int bytes) {
+    store_le(data, value, bytes);
+    data += bytes;
+}
+
+/* read a field and move past it */
+static inline uint64_t get(const uint8_t *&data, int bytes) {
+    uint64_t result = load_le(data, bytes);
+    data += bytes;
+    return result;
+}
+
+/* write a snapshot */
+void write_snapshot(const sim_data &sim, uint8_t *data) {
+    uint8_t *start = data;
+
+    put(data, (uint32_t)sim.score, 4);
+    put(data, (uint32_t)sim.level, 4);
+    put(data, (uint32_t)sim.score_lvlup, 4);
+    put(data, sim.field_width, 2);
+    put(data, sim.field_height, 2);
+
+    for(int i = 0; i < NEXT_PIECES_CNT; i++) {
+        const piece &p = sim.next_pieces.pieces[i];
+        put(data, p.type, 1);
+        put(data, p.rotation, 1);
+        put(data, (uint16_t)p.position.x, 2);
+        put(data, (uint16_t)p.position.y, 2);
+    }
+    put(data, sim.next_pieces.head, 1);
+
+    put(data, sim.seed, 8);
+    for(int i = 0; i < 4; i++) put(data, sim.rng.s[i], 4);
+    for(int i = 0; i < 7; i++) put(data, sim.bag.types[i], 1);
+    put(data, sim.bag.next, 1);
+
+    put(data, sim.frame_num, 8);
+    put(data, sim.frame_next_update, 8);
+    put(data, sim.gravity_acc, 4);
+    put(data, sim.frame_last_move, 8);
+    put(data, sim.frame_last_down, 8);
+    put(data, sim.frame_last_rotate, 8);
+    put(data, sim.frame_last_swap, 8);
+    put(data, sim.frame_last_hard_drop, 8);
+
+    put(data, sim.game_over, 1);
+    put(data, sim.frame_game_over, 8);
+    assert(data - start == SNAPSHOT_FIXED_SIZE);
+
+    for(int y = 0; y < sim.field_height; y++) put(data, sim.field_rows[y], 2);
+    memcpy(data, sim.playing_field, sim.field_width * sim.field_height);
+
+#ifdef DEBUG_ZOBRIST
+    /* read the snapshot back, whose keys are worked out from the state */
+    sim_data check;
+    assert(read_snapshot(start, sim.field_width, sim.field_height, check) && zobrist_key(check) == zobrist_key(sim) && "incremental Zobrist key doesn't match the state after a snapshot round trip");
+#endif
+}
+
+/* restore a snapshot */
+bool read_snapshot(const uint8_t *data, int width, int height, sim_data &sim) {
+    if(!field_fits<uint16_t>(width, height)) return false;
+    const uint8_t *start = data;
+
+    sim_data result = {};
+    result.score = (int)(uint32_t)get(data, 4);
+    result.level = (int)(uint32_t)get(data, 4);
+    result.score_lvlup = (int)(uint32_t)get(data, 4);
+    result.field_width = (int)get(data, 2);
+    result.field_height = (int)get(data, 2);
+    if(result.field_width != width || result.field_height != height) return false;
+    result.row_full = (uint16_t)((1u << width) - 1);
+
+    for(int i = 0; i < NEXT_PIECES_CNT; i++) {
+        piece &p = result.next_pieces.pieces[i];
+        p.type = (uint8_t)get(data, 1);
+        p.rotation = (uint8_t)get(data, 1);
+        p.position.x = (int16_t)get(data, 2);
+        p.position.y = (int16_t)get(data, 2);
+        if(p.type >= 7 || p.rotation >= 4 || p.position.x < -3 || p.position.x >= width) return false; // pieces can stick out of the left wall by up to 3 columns
+    }
+    result.next_pieces.head = (uint8_t)get(data, 1);
+    if(result.next_pieces.head >= NEXT_PIECES_CNT) return false;
+
+    result.seed = get(data, 8);
+    for(int i = 0; i < 4; i++) result.rng.s[i] = (uint32_t)get(data, 4);
+    for(int i = 0; i < 7; i++) {
+        result.bag.types[i] = (uint8_t)get(data, 1);
+        if(result.bag.types[i] >= 7) return false;
+    }
+    result.bag.next = (uint8_t)get(data, 1);
+    if(result.bag.next > 7) return false;
+
+    result.frame_num = get(data, 8);
+    result.frame_next_update = get(data, 8);
+    result.gravity_acc = (uint32_t)get(data, 4);
+    result.frame_last_move = get(data, 8);
+    result.frame_last_down = get(data, 8);
+    result.frame_last_rotate = get(data, 8);
+    result.frame_last_swap = get(data, 8);
+    result.frame_last_hard_drop = get(data, 8);
+
+    result.game_over = get(data, 1) != 0;
+    result.frame_game_over = get(data, 8);
+    assert(data - start == SNAPSHOT_FIXED_SIZE);
+
+    for(int y = 0; y < height; y++) {
+        result.field_rows[y] = (uint16_t)get(data, 2);
+        if(result.field_rows[y] & ~result.row_full) return false;
+    }
+    memcpy(result.playing_field, data, width * height);
+    refresh_column_tops(result);
+    refresh_zobrist(result);
+
+    copy_sim(sim, result);
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "sim.h"
+
+using namespace std;
+
+/**
+ * @brief The size of a snapshot's fixed part (in bytes), i.e. everything but the playing field; see write_snapshot().
+ *
+ */
+#define SNAPSHOT_FIXED_SIZE     (3 * 4 + 2 * 2 + NEXT_PIECES_CNT * 6 + 1 + 8 + 4 * 4 + 8 + 8 + 8 + 4 + 5 * 8 + 1 + 8)
+
+/**
+ * @brief Write an integer's lowest bytes in little endian order.
+ *
+ * @param data Where to write the bytes.
+ * @param value The integer.
+ * @param bytes The number of bytes to write.
+ */
+inline void store_le(uint8_t *data, uint64_t value, int bytes) {
+    for(int i = 0; i < bytes; i++) data[i] = (uint8_t)(value >> (8 * i));
+}
+
+/**
+ * @brief Read an integer stored in little endian order.
+ *
+ * @param data Where to read the bytes from.
+ * @param bytes The number of bytes to read.
+ * @return uint64_t The integer, zero-extended.
+ */
+inline uint64_t load_le(const uint8_t *data, int bytes) {
+    uint64_t result = 0;
+    for(int i = 0; i < bytes; i++) result |= (uint64_t)data[i] << (8 * i);
+    return result;
+}
+
+/**
+ * @brief Get the size of a simulation's snapshot (in bytes). Snapshots of the same playing field size are always the same size, so they can be stored in arrays and found by index.
+ *
+ * @param width The playing field's width (in cells).
+ * @param height The playing field's height (in cells).
+ * @return size_t The snapshot size.
+ */
+inline size_t snapshot_size(int width, int height) {
+    return SNAPSHOT_FIXED_SIZE + height * sizeof(uint16_t) + width * height;
+}
+
+/**
+ * @brief Write a snapshot of a simulation's full state: its score, level, playing field, next pieces queue, piece generation state and frame counters. The fields are written one by one in little endian order, so snapshots don't depend on the compiler's structure layout. The column heights and Zobrist keys aren't written, as they're rebuilt from the playing field and next pieces queue.
+ *
+ * @param sim The simulation data structure.
+ * @param data Where to write the snapshot. This must have room for snapshot_size() bytes.
+ */
+void write_snapshot(const sim_data &sim, uint8_t *data);
+
+/**
+ * @brief Restore a simulation's state from a snapshot.
+ *
+ * @param data The snapshot.
+ * @param width The playing field's expected width (in cells).
+ * @param height The playing field's expected height (in cells).
+ * @param sim The simulation data structure to restore the state into.
+ * @return true Returned if the state has been restored.
+ * @return false Returned if the snapshot is of a different playing field size, or holds values that a simulation can't have; sim is left untouched in that case.
+ */
+bool read_snapshot(const uint8_t *data, int width, int height, sim_data &sim);
+
+#endif
@@ -0,0 +1,125 @@
+#include "thread_pool.h"
+#include "utils.h"
+
+using namespace std;
+
+/* the pool and queue index of the worker running on this thread, if any */
+static thread_local thread_pool *worker_pool = nullptr;
+static thread_local size_t worker_index = 0;
+
+/* take a task from the given worker's own queue, or steal one from another worker's queue */
+static bool take_task(thread_pool &pool, size_t self, function<void()> &task) {
+    size_t n = pool.queues.size();
+
+    for(size_t i = 0; i < n; i++) {
+        task_queue &queue = *pool.queues[(self + i) % n];
+        lock_guard<mutex> guard(queue.lock);
+        if(queue.tasks.empty()) continue;
+
+        if(i == 0) {
+            /* own queue: newest task first, as its data is most likely still in cache */
+            task = move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            /* someone else's queue: oldest task first, as it's likely to be the biggest */
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        pool.queued--;
+        return true;
+    }
+
+    return false;
+}
+
+/* worker thread routine */
+static void worker_main(thread_pool &pool, size_t self) {
+    worker_pool = &pool; worker_index = self;
+
+    function<void()> task;
+    while(true) {
+        if(take_task(pool, self, task)) {
+            task();
+            continue;
+        }
+
+        /* nothing to do - sleep until more tasks come in */
+        unique_lock<mutex> guard(pool.idle_lock);
+        pool.idle_cond.wait(guard, [&pool] { return pool.queued > 0 || pool.stopping; });
+        if(pool.stopping && pool.queued == 0) break;
+    }
+}
+
+/* start worker threads */
+void start_thread_pool(thread_pool &pool, int threads) {
+    if(threads <= 0) threads = MAX((int)thread::hardware_concurrency(), 1);
+
+    pool.queued = 0; pool.next_queue = 0;
+    pool.stopping = false;
+
+    pool.queues.clear();
+    for(int i = 0; i < threads; i++) pool.queues.emplace_back(new task_queue);
+    for(int i = 0; i < threads; i++) pool.workers.emplace_back(worker_main, ref(pool), (size_t)i);
+}
+
+/* stop worker threads */
+void stop_thread_pool(thread_pool &pool) {
+    {
+        lock_guard<mutex> guard(pool.idle_lock);
+        pool.stopping = true;
+    }
+    pool.idle_cond.notify_all();
+
+    for(thread &worker : pool.workers) worker.join();
+    pool.workers.clear();
+    pool.queues.clear();
+}
+
+/* get number of worker threads */
+int pool_threads(const thread_pool &pool) {
+    return (int)pool.workers.size();
+}
+
+/* submit a task */
+void pool_submit(thread_pool &pool, task_group &group, function<void()> task) {
+    group.pending++;
+
+    size_t index = (worker_pool == &pool) ? worker_index : (pool.next_queue++ % pool.queues.size());
+    {
+        task_queue &queue = *pool.queues[index];
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.emplace_back([&group, task] {
+            task();
+            group.pending--;
+        });
+        pool.queued++;
+    }
+
+    /* taking the idle lock ensures that a worker which has just found no tasks is already waiting, and will get the notification */
+    { lock_guard<mutex> guard(pool.idle_lock); }
+    pool.idle_cond.notify_one();
+}
+
+/* wait for a task group, running tasks in the meantime */
+void pool_wait(thread_pool &pool, task_group &group) {
+    size_t self = (worker_pool == &pool) ? worker_index : 0;
+
+    function<void()> task;
+    while(group.pending > 0) {
+        if(take_task(pool, self, task)) task();
+        else this_thread::yield();
+    }
+}
+
+/* run a function over an index range in parallel */
+void pool_parallel_for(thread_pool &pool, size_t count, size_t chunk, const function<void(size_t, size_t)> &func) {
+    if(chunk == 0) chunk = 1;
+
+    task_group group;
+    for(size_t start = 0; start < count; start += chunk) {
+        size_t end = MIN(start + chunk, count);
+        pool_submit(pool, group, [&func, start, end] { func(start, end); });
+    }
+    pool_wait(pool, group);
+}
@@ -0,0 +1,103 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <bits/stdc++.h>
+
+using namespace std;
+
+/**
+ * @brief A worker thread's task queue. The worker takes tasks from the back, while idle workers steal from the front.
+ *
+ * @field lock The queue's lock.
+ * @field tasks The queued tasks.
+ *
+ */
+struct task_queue {
+    mutex lock;
+    deque<function<void()>> tasks;
+};
+
+/**
+ * @brief Work-stealing thread pool. Each worker has its own task queue, and steals from the others once it runs out of work, so uneven tasks (e.g. games of different lengths) still keep every core busy.
+ *
+ * @field workers The worker threads.
+ * @field queues The task queues, one per worker.
+ * @field queued The number of tasks sitting in the queues.
+ * @field next_queue Round-robin counter for picking the queue of tasks submitted from outside the pool.
+ * @field idle_lock Lock for idle workers to wait on.
+ * @field idle_cond Condition variable that wakes up idle workers when tasks are submitted or the pool is stopped.
+ * @field stopping Set when the pool is being stopped.
+ *
+ */
+struct thread_pool {
+    vector<thread> workers;
+    vector<unique_ptr<task_queue>> queues;
+    atomic<size_t> queued;
+    atomic<size_t> next_queue;
+
+    mutex idle_lock;
+    condition_variable idle_cond;
+    bool stopping;
+};
+
+/**
+ * @brief A group of tasks that can be waited on together. Groups can be nested, i.e. a task may submit tasks of its own and wait on them.
+ *
+ * @field pending The number of the group's tasks that have not finished yet.
+ *
+ */
+struct task_group {
+    atomic<size_t> pending{0};
+};
+
+/**
+ * @brief Start a thread pool's workers.
+ *
+ * @param pool The thread pool, which must not be running yet.
+ * @param threads The number of worker threads; 0 picks the number of hardware threads.
+ */
+void start_thread_pool(thread_pool &pool, int threads = 0);
+
+/**
+ * @brief Stop a thread pool's workers, after they have finished all queued tasks.
+ *
+ * @param pool The thread pool.
+ */
+void stop_thread_pool(thread_pool &pool);
+
+/**
+ * @brief Get the number of worker threads in a thread pool.
+ *
+ * @param pool The thread pool.
+ * @return int The number of worker threads.
+ */
+int pool_threads(const thread_pool &pool);
+
+/**
+ * @brief Submit a task to a thread pool. Tasks submitted by a worker go to that worker's own queue; others are spread across the queues.
+ *
+ * @param pool The thread pool.
+ * @param group The task group that the task belongs to.
+ * @param task The task.
+ */
+void pool_submit(thread_pool &pool, task_group &group, function<void()> task);
+
+/**
+ * @brief Wait for all of a task group's tasks to finish. The calling thread runs queued tasks while it waits, so this can be called from within a task.
+ *
+ * @param pool The thread pool.
+ * @param group The task group.
+ */
+void pool_wait(thread_pool &pool, task_group &group);
+
+/**
+ * @brief Run a function over a range of indices in parallel, split into chunks, and wait for it to finish.
+ *
+ * @param pool The thread pool.
+ * @param count The number of indices; the function is called over [0, count).
+ * @param chunk The number of indices per task.
+ * @param func The function, which is called with the start (inclusive) and end (exclusive) of each chunk.
+ */
+void pool_parallel_for(thread_pool &pool, size_t count, size_t chunk, const function<void(size_t, size_t)> &func);
+
+#endif
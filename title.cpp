@@ -1,5 +1,6 @@
 #include "title.h"
 #include "utils.h"
+#include "input.h"
 #include "config.h"
 #include "settings.h"
 #include "scoreboard.h"
@@ -36,6 +37,14 @@ title_data new_title(json settings) {
     return new_title(get_level(settings));
 }
 
+/* check a menu key: each press goes through, and a held key repeats at the menu speed once its delay has passed */
+static bool menu_key(const title_data &title, key_code key, uint64_t &frame_last) {
+    bool ready = frame_last == 0 || title.frame_num - frame_last >= FRAME_RATE / SPEED_INPUT_MENU;
+    if(!input_pressed(key) && !(ready && input_held(key, INPUT_DAS_MS))) return false;
+    frame_last = title.frame_num;
+    return true;
+}
+
 /* handle title input */
 bool handle_title_input(title_data &title) {
     if(key_released(RETURN_KEY)) {
@@ -50,23 +59,19 @@ bool handle_title_input(title_data &title) {
     }
 
     if(!title.show_scoreboard) { // block all input if showing scoreboard
-        if(key_down(UP_KEY) && (title.frame_last_ud == 0 || title.frame_num - title.frame_last_ud >= FRAME_RATE / SPEED_INPUT_MENU)) {
-            title.frame_last_ud = title.frame_num;
+        if(menu_key(title, UP_KEY, title.frame_last_ud)) {
             if((int)title.selection > 0) title.selection = (title_selection)((int)title.selection - 1);
         }
 
-        if(key_down(DOWN_KEY) && (title.frame_last_ud == 0 || title.frame_num - title.frame_last_ud >= FRAME_RATE / SPEED_INPUT_MENU)) {
-            title.frame_last_ud = title.frame_num;
+        if(menu_key(title, DOWN_KEY, title.frame_last_ud)) {
             if((int)title.selection < 1) title.selection = (title_selection)((int)title.selection + 1);
         }
 
-        if(key_down(LEFT_KEY) && (title.frame_last_lr == 0 || title.frame_num - title.frame_last_lr >= FRAME_RATE / SPEED_INPUT_MENU)) {
-            title.frame_last_lr = title.frame_num;
+        if(menu_key(title, LEFT_KEY, title.frame_last_lr)) {
             if(title.level > 0) title.level--;
         }
 
-        if(key_down(RIGHT_KEY) && (title.frame_last_lr == 0 || title.frame_num - title.frame_last_lr >= FRAME_RATE / SPEED_INPUT_MENU)) {
-            title.frame_last_lr = title.frame_num;
+        if(menu_key(title, RIGHT_KEY, title.frame_last_lr)) {
             title.level++;
         }
     }
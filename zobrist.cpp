@@ -0,0 +1,104 @@
+#include "zobrist.h"
+#include "utils.h"
+
+using namespace std;
+
+/* splitmix64, for filling the keys table at compile time */
+static constexpr uint64_t zobrist_next(uint64_t &x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* generate the keys table; the keys only depend on this seed, so they (and any keys derived from them) are the same on every run */
+static constexpr zobrist_table make_zobrist_table() {
+    zobrist_table result = {};
+    uint64_t x = 0x5A0B215EED5ULL;
+
+    for(int y = 0; y < ZOBRIST_MAX_HEIGHT; y++) {
+        for(int i = 0; i < ZOBRIST_MAX_WIDTH; i++) result.cells[y][i] = zobrist_next(x);
+    }
+    for(int i = 0; i < NEXT_PIECES_CNT; i++) {
+        for(int t = 0; t < 7; t++) result.pieces[i][t] = zobrist_next(x);
+    }
+    result.game_over = zobrist_next(x);
+
+    return result;
+}
+
+constexpr zobrist_table zobrist_keys = make_zobrist_table();
+
+static_assert(sizeof(tt_bucket) == 64, "transposition table buckets should fill a cache line");
+
+/* pack an entry's data: the value in the low 48 bits, then the depth and the age */
+static inline uint64_t pack_tt_data(const tt_data &data, uint8_t age) {
+    return ((uint64_t)data.value & 0xFFFFFFFFFFFFULL) | (uint64_t)data.depth << 48 | (uint64_t)age << 56;
+}
+
+/* allocate a transposition table */
+void resize_tt(transposition_table &table, size_t megabytes) {
+    size_t buckets = 1;
+    while(buckets * 2 * sizeof(tt_bucket) <= megabytes * 1024 * 1024) buckets *= 2;
+
+    table.buckets.reset(new tt_bucket[buckets]);
+    table.mask = buckets - 1;
+    clear_tt(table);
+}
+
+/* clear a transposition table */
+void clear_tt(transposition_table &table) {
+    for(size_t i = 0; i <= table.mask; i++) {
+        for(tt_entry &entry : table.buckets[i].entries) {
+            entry.check.store(0, memory_order_relaxed);
+            entry.data.store(0, memory_order_relaxed);
+        }
+    }
+    table.age = 1;
+}
+
+/* start a new search */
+void tt_new_search(transposition_table &table) {
+    table.age++;
+    if(table.age == 0) table.age = 1;
+}
+
+/* look up a state */
+bool tt_probe(const transposition_table &table, uint64_t key, tt_data &result) {
+    const tt_bucket &bucket = table.buckets[key & table.mask];
+    for(const tt_entry &entry : bucket.entries) {
+        uint64_t data = entry.data.load(memory_order_relaxed), check = entry.check.load(memory_order_relaxed);
+        if((check ^ data) != key) continue; // another state's entry, or one that's being written
+
+        result.value = (int64_t)(data << 16) >> 16; // sign-extend the 48-bit value
+        result.depth = (uint8_t)(data >> 48);
+        return true;
+    }
+    return false;
+}
+
+/* store a state */
+void tt_store(transposition_table &table, uint64_t key, const tt_data &data) {
+    tt_bucket &bucket = table.buckets[key & table.mask];
+
+    /* replace the state's own entry if it has one, or else the oldest and shallowest one */
+    tt_entry *victim = nullptr;
+    int victim_worth = INT_MAX;
+    for(tt_entry &entry : bucket.entries) {
+        uint64_t old = entry.data.load(memory_order_relaxed);
+        if((entry.check.load(memory_order_relaxed) ^ old) == key) {
+            victim = &entry;
+            break;
+        }
+
+        int worth = (int)(uint8_t)(old >> 48) - 8 * (uint8_t)(table.age - (uint8_t)(old >> 56)); // each search that has passed is worth 8 plies
+        if(worth < victim_worth) {
+            victim = &entry;
+            victim_worth = worth;
+        }
+    }
+
+    uint64_t packed = pack_tt_data(data, table.age);
+    victim->data.store(packed, memory_order_relaxed);
+    victim->check.store(key ^ packed, memory_order_relaxed);
+}
@@ -0,0 +1,166 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "piece.h"
+#include "config.h"
+
+using namespace std;
+
+/**
+ * @brief The largest playing field width that Zobrist keys are generated for, i.e. the widest bitboard row.
+ *
+ */
+#define ZOBRIST_MAX_WIDTH       64
+
+/**
+ * @brief The largest playing field height that Zobrist keys are generated for, i.e. the tallest field of the widest bitboard row type.
+ *
+ */
+#define ZOBRIST_MAX_HEIGHT      FIELD_MAX_HEIGHT_64
+
+/**
+ * @brief Zobrist hashing keys: a random 64-bit key for each occupied cell and for each queued piece type. A state's key is the XOR of the keys of everything in it, so that it can be updated with a few XORs as cells and pieces come and go.
+ *
+ * @field cells The key for each occupied playing field cell, indexed by Y and X coordinates.
+ * @field pieces The key for each piece type in each slot of the next pieces queue (counted from its head, i.e. slot 0 holds the falling piece).
+ * @field game_over The key for the game over flag.
+ *
+ */
+struct zobrist_table {
+    uint64_t cells[ZOBRIST_MAX_HEIGHT][ZOBRIST_MAX_WIDTH];
+    uint64_t pieces[NEXT_PIECES_CNT][7];
+    uint64_t game_over;
+};
+
+/**
+ * @brief The Zobrist keys table, generated at compile time.
+ *
+ */
+extern const zobrist_table zobrist_keys;
+
+/**
+ * @brief Get the Zobrist key of a playing field row's occupied cells.
+ *
+ * @tparam row_t The bitboard row type.
+ * @param y The row's Y coordinate.
+ * @param row The row's occupancy bitboard.
+ * @return uint64_t The XOR of the occupied cells' keys.
+ */
+template<typename row_t>
+inline uint64_t zobrist_row(int y, row_t row) {
+    uint64_t result = 0;
+    for(uint64_t bits = row; bits; bits &= bits - 1) result ^= zobrist_keys.cells[y][__builtin_ctzll(bits)];
+    return result;
+}
+
+/**
+ * @brief Get the Zobrist key of a next pieces queue: the type of the piece in each of its slots. The pieces' rotations and positions aren't keyed, so the falling piece's moves don't change the key, and the key only depends on what's in the queue.
+ *
+ * @param pieces The next pieces queue.
+ * @return uint64_t The XOR of the pieces' keys.
+ */
+inline uint64_t zobrist_queue(const piece_queue &pieces) {
+    uint64_t result = 0;
+    for(int i = 0; i < NEXT_PIECES_CNT; i++) {
+        result ^= zobrist_keys.pieces[i][pieces[i].type];
+    }
+    return result;
+}
+
+/**
+ * @brief The number of entries in each transposition table bucket. Four 16-byte entries make a 64-byte bucket, i.e. a single cache line.
+ *
+ */
+#define TT_BUCKET_ENTRIES       4
+
+/**
+ * @brief A transposition table entry. The entry's key isn't stored as is, but XORed with its data, so that an entry torn by two threads writing it at once (which is allowed, as there are no locks) fails the key check and reads as a miss instead of returning another state's data.
+ *
+ * @field check The entry's key XORed with its data.
+ * @field data The entry's packed data; see tt_data.
+ *
+ */
+struct tt_entry {
+    atomic<uint64_t> check;
+    atomic<uint64_t> data;
+};
+
+/**
+ * @brief A transposition table bucket: the entries that a key can be stored in.
+ *
+ * @field entries The bucket's entries.
+ *
+ */
+struct tt_bucket {
+    tt_entry entries[TT_BUCKET_ENTRIES];
+};
+
+/**
+ * @brief Lock-free transposition table, shared by search threads to look up the results of states they have already searched. Its memory use is fixed when it's sized; once full, entries from older searches and of shallower depths are replaced first.
+ *
+ * @field buckets The buckets.
+ * @field mask The bucket index mask (the number of buckets, which is a power of two, minus one).
+ * @field age The current search's age, which is stored in entries so that those left by earlier searches get replaced first. This is never zero, so that used entries are never all zeros.
+ *
+ */
+struct transposition_table {
+    unique_ptr<tt_bucket[]> buckets;
+    size_t mask;
+    uint8_t age;
+};
+
+/**
+ * @brief Data stored in a transposition table entry.
+ *
+ * @field value The stored value (e.g. a node count or score), which must fit in 48 bits (signed).
+ * @field depth The remaining search depth that the value was found with; deeper entries are kept over shallower ones.
+ *
+ */
+struct tt_data {
+    int64_t value;
+    uint8_t depth;
+};
+
+/**
+ * @brief (Re)allocate a transposition table with the given size, and clear it.
+ *
+ * @param table The transposition table. It must not be in use by other threads.
+ * @param megabytes The table's size (in megabytes), which is rounded down to a power of two number of buckets.
+ */
+void resize_tt(transposition_table &table, size_t megabytes);
+
+/**
+ * @brief Clear all entries in a transposition table.
+ *
+ * @param table The transposition table. It must not be in use by other threads.
+ */
+void clear_tt(transposition_table &table);
+
+/**
+ * @brief Start a new search on a transposition table, so that the previous searches' entries are replaced first.
+ *
+ * @param table The transposition table. It must not be in use by other threads.
+ */
+void tt_new_search(transposition_table &table);
+
+/**
+ * @brief Look up a state in a transposition table. This is safe to call while other threads are probing or storing.
+ *
+ * @param table The transposition table.
+ * @param key The state's key.
+ * @param result The entry's data, if it's found.
+ * @return true Returned if the state has been found.
+ * @return false Returned otherwise.
+ */
+bool tt_probe(const transposition_table &table, uint64_t key, tt_data &result);
+
+/**
+ * @brief Store a state's data in a transposition table, replacing its existing entry, or otherwise the entry of the bucket that's least worth keeping. This is safe to call while other threads are probing or storing.
+ *
+ * @param table The transposition table.
+ * @param key The state's key.
+ * @param data The data to store.
+ */
+void tt_store(transposition_table &table, uint64_t key, const tt_data &data);
+
+#endif